@@ -0,0 +1,109 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace hardwave {
+namespace heapfree {
+namespace bench {
+
+/// Make sure the compiler can not optimize away the computation
+/// of the given value
+template<typename T>
+inline void do_not_optimize(const T &v) {
+  asm volatile("" : : "r,m"(v) : "memory");
+}
+
+/// Run `fn` repeatedly and print the average time it took per
+/// operation; `ops` is the number of operations performed by a
+/// single invocation of `fn`.
+template<typename Fn>
+void measure(const char *name, size_t iterations, size_t ops, Fn &&fn) {
+  fn(); // Warm up
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++)
+    fn();
+  auto end = std::chrono::steady_clock::now();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::printf("%-48s %10.3f ns/op\n", name, double(ns) / double(iterations) / double(ops));
+}
+
+/// Counts the cache misses (as reported by the CPU's last level cache)
+/// of this thread through the Linux perf interface.
+///
+/// Hardware counters are not available everywhere (e.g. not in most
+/// virtual machines, or with a restrictive perf_event_paranoid setting);
+/// in that case available() is false.
+class cache_miss_counter {
+  int fd{-1};
+
+public:
+  cache_miss_counter() {
+#ifdef __linux__
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  ~cache_miss_counter() {
+#ifdef __linux__
+    if (fd >= 0)
+      close(fd);
+#endif
+  }
+
+  cache_miss_counter(const cache_miss_counter&) = delete;
+  cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+
+  bool available() const { return fd >= 0; }
+
+  /// Run fn and return the number of cache misses it caused
+  template<typename Fn>
+  std::uint64_t count(Fn &&fn) {
+    std::uint64_t r{0};
+#ifdef __linux__
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    fn();
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &r, sizeof(r)) != sizeof(r))
+      r = 0;
+#else
+    fn();
+#endif
+    return r;
+  }
+};
+
+/// Run `fn` once and print the number of cache misses per operation;
+/// prints n/a if there are no hardware counters.
+template<typename Fn>
+void measure_misses(const char *name, size_t ops, Fn &&fn) {
+  cache_miss_counter counter;
+  if (!counter.available()) {
+    std::printf("%-48s %10s misses/op\n", name, "n/a");
+    return;
+  }
+  fn(); // Warm up
+  auto misses = counter.count(fn);
+  std::printf("%-48s %10.3f misses/op\n", name, double(misses) / double(ops));
+}
+
+} // namespace bench
+} // namespace heapfree
+} // namespace hardwave
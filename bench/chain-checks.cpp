@@ -0,0 +1,79 @@
+#include <vector>
+#include "hardwave/heapfree/chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t elements = 4096;
+constexpr size_t iterations = 20000;
+
+using handler_fn = void (*)(void*, long&);
+
+void handler(void*, long &acc) {
+  acc++;
+}
+
+template<typename Chain, bool Lean = false>
+void bench_traversal(const char *name) {
+  Chain ch;
+  std::vector<typename Chain::segment> segs(elements);
+  for (auto &seg : segs) {
+    *seg = 1;
+    ch.link_back(seg);
+  }
+
+  measure(name, iterations, elements, [&]() {
+    long sum = 0;
+    if constexpr (Lean) {
+      for (const auto &v : ch.lean_values())
+        sum += v;
+    } else {
+      for (const auto &v : ch)
+        sum += v;
+    }
+    do_not_optimize(sum);
+  });
+}
+
+// Mirrors the listener loop in try_fire()
+template<typename Chain, bool Lean = false>
+void bench_fire(const char *name) {
+  Chain ch;
+  std::vector<typename Chain::segment> segs(elements);
+  for (auto &seg : segs) {
+    *seg = &handler;
+    ch.link_back(seg);
+  }
+
+  measure(name, iterations, elements, [&]() {
+    long acc = 0;
+    if constexpr (Lean) {
+      for (auto &seg : ch.lean_segments())
+        seg.value()((void*)&seg, acc);
+    } else {
+      for (auto &seg : ch.segments())
+        seg.value()((void*)&seg, acc);
+    }
+    do_not_optimize(acc);
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  bench_traversal<chain<long, checked>>("traversal checked");
+  bench_traversal<chain<long, debug_only>>("traversal debug_only");
+  bench_traversal<chain<long, unchecked>>("traversal unchecked");
+  bench_traversal<chain<long, checked>, true>("traversal lean iterator checked");
+  bench_traversal<chain<long, unchecked>, true>("traversal lean iterator unchecked");
+
+  bench_fire<chain<handler_fn, checked>>("fire loop checked");
+  bench_fire<chain<handler_fn, debug_only>>("fire loop debug_only");
+  bench_fire<chain<handler_fn, unchecked>>("fire loop unchecked");
+  bench_fire<chain<handler_fn, checked>, true>("fire loop lean iterator checked");
+  bench_fire<chain<handler_fn, unchecked>, true>("fire loop lean iterator unchecked");
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include <cstdio>
+#include "hardwave/heapfree/chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t elements = 512;
+constexpr size_t iterations = 50000;
+
+template<typename Chain>
+void bench_link(const char *loop_name, const char *range_name) {
+  static typename Chain::segment segs[elements];
+  Chain ch;
+
+  measure(loop_name, iterations, elements, [&]() {
+    for (auto &seg : segs)
+      ch.link_back(seg);
+    do_not_optimize(ch);
+    for (auto it = ch.begin(); it != ch.end();)
+      it = ch.unlink(it);
+  });
+
+  measure(range_name, iterations, elements, [&]() {
+    ch.link_range(ch.end(), segs);
+    do_not_optimize(ch);
+    ch.unlink_range(ch.begin(), ch.end());
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  bench_link<chain<int>>(
+      "link_back + unlink loop chain",
+      "link_range + unlink_range chain");
+  bench_link<chain<int, counted>>(
+      "link_back + unlink loop chain<counted>",
+      "link_range + unlink_range chain<counted>");
+  bench_link<chain<int, unchecked>>(
+      "link_back + unlink loop chain<unchecked>",
+      "link_range + unlink_range chain<unchecked>");
+  return 0;
+}
@@ -0,0 +1,161 @@
+#include <vector>
+#include <optional>
+#include <random>
+#include <algorithm>
+#include "hardwave/heapfree/chain.hpp"
+#include "hardwave/heapfree/event.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t elements = 1 << 16;
+constexpr size_t iterations = 50;
+
+/// Evict the given memory from all caches before each run
+template<typename T>
+void flush_caches(const std::vector<T> &mem) {
+  auto p = reinterpret_cast<const char*>(mem.data());
+  for (size_t i = 0; i < mem.size() * sizeof(T); i += cache_line_size) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_clflush(p + i);
+#else
+    // Without clflush the caches can only be evicted by touching lots
+    // of other memory; depending on the cache size this might not work
+    static std::vector<char> junk(256 << 20);
+    for (size_t j = 0; j < junk.size(); j += cache_line_size)
+      junk[j]++;
+    do_not_optimize(junk[0]);
+    break;
+#endif
+  }
+}
+
+/// Some work per value, so there is something to overlap with
+inline long work(long v) {
+  for (int i = 0; i < 16; i++)
+    v = v * 31 + 7;
+  return v;
+}
+
+using chain_t = chain<long, unchecked>;
+
+void bench_traversal() {
+  chain_t ch;
+  std::vector<chain_t::segment> segs(elements);
+  std::vector<chain_t::segment*> order;
+  for (auto &seg : segs) {
+    *seg = 1;
+    order.push_back(&seg);
+  }
+  // Random link order, so the hardware prefetcher can not help
+  std::shuffle(order.begin(), order.end(), std::mt19937{42});
+  for (auto seg : order)
+    ch.link_back(*seg);
+
+  measure("cold traversal lean_values", iterations, elements, [&]() {
+    flush_caches(segs);
+    long sum = 0;
+    for (const auto &v : ch.lean_values())
+      sum += work(v);
+    do_not_optimize(sum);
+  });
+  measure("  flush_caches() alone", iterations, elements, [&]() {
+    flush_caches(segs);
+  });
+
+  measure("cold traversal for_each_prefetch", iterations, elements, [&]() {
+    flush_caches(segs);
+    long sum = 0;
+    for_each_prefetch(ch, [&](long v) { sum += work(v); });
+    do_not_optimize(sum);
+  });
+
+  measure("hot traversal lean_values", iterations * 10, elements, [&]() {
+    long sum = 0;
+    for (const auto &v : ch.lean_values())
+      sum += work(v);
+    do_not_optimize(sum);
+  });
+  measure("hot traversal for_each_prefetch", iterations * 10, elements, [&]() {
+    long sum = 0;
+    for_each_prefetch(ch, [&](long v) { sum += work(v); });
+    do_not_optimize(sum);
+  });
+}
+
+using handler_fn = void (*)(void*, long&);
+
+// Mirrors the listeners of an event: a function pointer in the segment,
+// followed by a lambda context of a full cache line
+using handler_chain = chain<handler_fn, unchecked>;
+struct handler : handler_chain::segment {
+  long add;
+  char pad[cache_line_size - sizeof(long)];
+
+  handler() : handler_chain::segment{&call}, add{1} {}
+
+  static void call(void *self, long &acc) {
+    acc += static_cast<handler*>(self)->add;
+  }
+};
+
+void bench_fire() {
+  handler_chain ch;
+  std::vector<handler> handlers(elements);
+  std::vector<handler*> order;
+  for (auto &h : handlers)
+    order.push_back(&h);
+  std::shuffle(order.begin(), order.end(), std::mt19937{42});
+  for (auto h : order)
+    ch.link_back(*h);
+
+  measure("cold listener loop", iterations, elements, [&]() {
+    flush_caches(handlers);
+    long acc = 0;
+    for (auto &seg : ch.lean_segments())
+      seg.value()((void*)&seg, acc);
+    do_not_optimize(acc);
+  });
+
+  measure("cold listener loop prefetching", iterations, elements, [&]() {
+    flush_caches(handlers);
+    long acc = 0;
+    for_each_segment_prefetch(ch, [&](auto &seg) {
+      seg.value()((void*)&seg, acc);
+    }, sizeof(handler_chain::segment) + cache_line_size);
+    do_not_optimize(acc);
+  });
+
+  event<long&> ev;
+  struct context { long add; char pad[cache_line_size - sizeof(long)]; };
+  auto make = [&](long add) {
+    return on(ev, [ctx = context{add, {}}](long &acc) { acc += ctx.add; });
+  };
+  using handler_t = decltype(make(0));
+  // Register the listeners in random memory order
+  std::vector<std::optional<handler_t>> listeners(elements);
+  std::vector<size_t> idx(elements);
+  for (size_t i = 0; i < elements; i++)
+    idx[i] = i;
+  std::shuffle(idx.begin(), idx.end(), std::mt19937{42});
+  for (auto i : idx)
+    listeners[i].emplace(make(1));
+
+  measure("cold try_fire", iterations, elements, [&]() {
+    flush_caches(listeners);
+    long acc = 0;
+    try_fire<long&>(ev, acc);
+    do_not_optimize(acc);
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  bench_traversal();
+  bench_fire();
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "hardwave/heapfree/chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+using chain_t = chain<long, unchecked>;
+
+/// Link the segments in random order, so traversal jumps
+/// around in memory
+void link_shuffled(chain_t &ch, std::vector<chain_t::segment> &segs) {
+  std::vector<chain_t::segment*> order;
+  for (auto &seg : segs)
+    order.push_back(&seg);
+  std::shuffle(order.begin(), order.end(), std::mt19937{42});
+  ch.clear();
+  for (auto seg : order)
+    ch.link_back(*seg);
+}
+
+// Reports the time and the cache misses per segment
+void bench_traversal(const char *name, size_t iterations, chain_t &ch, size_t elements) {
+  auto traverse = [&]() {
+    long sum = 0;
+    for (const auto &v : ch.lean_values())
+      sum += v;
+    do_not_optimize(sum);
+  };
+  measure(name, iterations, elements, traverse);
+  measure_misses(name, elements, traverse);
+}
+
+void bench_relink(size_t elements) {
+  const size_t iterations = std::max<size_t>(2, 20'000'000 / elements);
+  chain_t ch;
+  std::vector<chain_t::segment> segs(elements);
+  for (auto &seg : segs)
+    *seg = 1;
+  char name[64];
+
+  link_shuffled(ch, segs);
+  std::snprintf(name, sizeof(name), "traversal shuffled %zu", elements);
+  bench_traversal(name, iterations, ch, elements);
+
+  std::snprintf(name, sizeof(name), "link shuffled %zu", elements);
+  measure(name, 1, elements, [&]() {
+    link_shuffled(ch, segs);
+  });
+  std::snprintf(name, sizeof(name), "link shuffled + relink_by_address() %zu", elements);
+  measure(name, 1, elements, [&]() {
+    link_shuffled(ch, segs);
+    ch.relink_by_address();
+  });
+  std::snprintf(name, sizeof(name), "traversal after relink_by_address() %zu", elements);
+  bench_traversal(name, iterations, ch, elements);
+
+  constexpr size_t steps = 4096;
+  chain_t::relink_progress progress;
+  size_t calls = 0;
+  std::snprintf(name, sizeof(name), "link shuffled + incremental relink %zu", elements);
+  measure(name, 1, elements, [&]() {
+    link_shuffled(ch, segs);
+    calls = 0;
+    while (!ch.relink_by_address(progress, steps))
+      calls++;
+  });
+  std::printf("%-48s %10zu calls\n", "  incremental relink steps of 4096", calls);
+  std::snprintf(name, sizeof(name), "traversal after incremental relink %zu", elements);
+  bench_traversal(name, iterations, ch, elements);
+}
+
+} // anonymous namespace
+
+int main() {
+  for (size_t n : {10'000, 1'000'000})
+    bench_relink(n);
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "hardwave/heapfree/chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+using chain_t = chain<unsigned, unchecked>;
+
+/// Fill the chain with random values, in the order it is currently linked in
+void shuffle_values(chain_t &ch, std::mt19937 &rng) {
+  for (auto &v : ch.lean_values())
+    v = rng();
+}
+
+void bench_sort(size_t elements) {
+  const size_t iterations = std::max<size_t>(1, 1'000'000 / elements);
+  chain_t ch;
+  std::vector<chain_t::segment> segs(elements);
+  for (auto &seg : segs)
+    ch.link_back(seg);
+  std::mt19937 rng{42};
+
+  char name[64];
+  std::snprintf(name, sizeof(name), "fill random %zu", elements);
+  measure(name, iterations, elements, [&]() {
+    shuffle_values(ch, rng);
+  });
+
+  std::snprintf(name, sizeof(name), "fill random + chain::sort %zu", elements);
+  measure(name, iterations, elements, [&]() {
+    shuffle_values(ch, rng);
+    ch.sort();
+  });
+
+  // What you have to do without chain::sort: copy into a heap allocated
+  // container, sort and write back
+  std::vector<unsigned> tmp;
+  std::snprintf(name, sizeof(name), "fill random + copy/stable_sort %zu", elements);
+  measure(name, iterations, elements, [&]() {
+    shuffle_values(ch, rng);
+    tmp.assign(ch.begin(), ch.end());
+    std::stable_sort(tmp.begin(), tmp.end());
+    std::copy(tmp.begin(), tmp.end(), ch.begin());
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  for (size_t n = 1000; n <= 10'000'000; n *= 10)
+    bench_sort(n);
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include <cstdio>
+#include <vector>
+#include "hardwave/heapfree/chain.hpp"
+#include "hardwave/heapfree/forward_chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t elements = 1 << 16;
+constexpr size_t iterations = 500;
+
+template<typename Chain>
+void bench_traversal(const char *name) {
+  Chain ch;
+  std::vector<typename Chain::segment> segs(elements);
+  for (auto &seg : segs) {
+    *seg = 1;
+    ch.link_back(seg);
+  }
+
+  measure(name, iterations, elements, [&]() {
+    long sum = 0;
+    for (const auto &v : ch)
+      sum += v;
+    do_not_optimize(sum);
+  });
+}
+
+template<typename Chain, typename PopFront>
+void bench_queue(const char *name, PopFront pop_front) {
+  Chain ch;
+  std::vector<typename Chain::segment> segs(elements);
+
+  measure(name, iterations, elements, [&]() {
+    for (auto &seg : segs)
+      ch.link_back(seg);
+    for (size_t i = 0; i < elements; i++)
+      pop_front(ch);
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  std::printf("%-48s %10zu bytes\n", "chain<long> segment size",
+      sizeof(chain<long>::segment));
+  std::printf("%-48s %10zu bytes\n", "forward_chain<long> segment size",
+      sizeof(forward_chain<long>::segment));
+
+  bench_traversal<chain<long>>("traversal chain");
+  bench_traversal<forward_chain<long>>("traversal forward_chain");
+
+  bench_queue<chain<long>>("queue link_back + unlink front chain",
+      [](auto &ch) { ch.unlink(ch.begin()); });
+  bench_queue<forward_chain<long>>("queue link_back + pop_front forward_chain",
+      [](auto &ch) { ch.pop_front(); });
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <unordered_map>
+#include "hardwave/heapfree/chain.hpp"
+#include "hardwave/heapfree/hash_chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t elements = 1 << 16;
+
+// Half of the lookups miss
+std::vector<unsigned> random_ids(size_t count) {
+  std::mt19937 rng{42};
+  std::vector<unsigned> r(count);
+  for (auto &k : r)
+    k = rng() % (2 * elements);
+  return r;
+}
+
+void bench_hash_chain(const std::vector<unsigned> &lookups) {
+  using chain_t = hash_chain<unsigned, unsigned>;
+  static chain_t::bucket buckets[elements];
+  chain_t ch{buckets};
+  std::vector<chain_t::segment> segs;
+  segs.reserve(elements);
+  for (unsigned i = 0; i < elements; i++)
+    ch.insert(segs.emplace_back(2 * i, i));
+
+  measure("hash_chain find", 100, std::size(lookups), [&]() {
+    for (auto k : lookups)
+      do_not_optimize(ch.contains(k));
+  });
+
+  measure("hash_chain erase + insert", 100, elements, [&]() {
+    for (auto &s : segs) {
+      s.unlink();
+      ch.insert(s);
+    }
+  });
+
+  static chain_t::bucket more[2 * elements];
+  measure("hash_chain rehash there and back", 1, elements, [&]() {
+    ch.rehash(more);
+    ch.finish_rehash();
+    ch.rehash(buckets);
+    ch.finish_rehash();
+  });
+}
+
+void bench_unordered_map(const std::vector<unsigned> &lookups) {
+  std::unordered_map<unsigned, unsigned> m;
+  m.reserve(elements);
+  for (unsigned i = 0; i < elements; i++)
+    m.emplace(2 * i, i);
+
+  measure("std::unordered_map find", 100, std::size(lookups), [&]() {
+    for (auto k : lookups)
+      do_not_optimize(m.find(k) != m.end());
+  });
+
+  measure("std::unordered_map erase + insert", 100, elements, [&]() {
+    for (unsigned i = 0; i < elements; i++) {
+      m.erase(2 * i);
+      m.emplace(2 * i, i);
+    }
+  });
+}
+
+void bench_chain(const std::vector<unsigned> &lookups) {
+  chain<unsigned> ch;
+  std::vector<chain<unsigned>::segment> segs;
+  segs.reserve(elements);
+  for (unsigned i = 0; i < elements; i++)
+    ch.link_back(segs.emplace_back(2 * i));
+
+  // Linear scans are slow; only use a few lookups
+  measure("chain linear find", 1, 100, [&]() {
+    for (size_t i = 0; i < 100; i++) {
+      bool found = false;
+      for (auto v : ch.lean_values())
+        if (v == lookups[i]) {
+          found = true;
+          break;
+        }
+      do_not_optimize(found);
+    }
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  auto lookups = random_ids(1 << 16);
+  bench_hash_chain(lookups);
+  bench_unordered_map(lookups);
+  bench_chain(lookups);
+  return 0;
+}
@@ -0,0 +1,13 @@
+#include "timers.hpp"
+
+using namespace hardwave::heapfree::bench;
+
+int main() {
+  // Timers with random deadlines; half of them are cancelled before they
+  // expire, the rest are popped in one go
+  constexpr unsigned horizon = 1u << 30;
+  auto w = random_timer_workload(1 << 16, horizon, 50);
+  bench_heap_chain(w, 20, horizon);
+  bench_priority_queue(w, 20, horizon);
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include <list>
+#include <memory>
+#include <random>
+#include <vector>
+#include <type_traits>
+#include "hardwave/heapfree/hetero_chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t elements = 1 << 16;
+constexpr size_t iterations = 500;
+
+struct circle { float r; };
+struct square { float a; };
+struct rect { float w, h; };
+
+struct shape {
+  virtual ~shape() = default;
+  virtual float area() const = 0;
+};
+struct v_circle : shape {
+  float r;
+  v_circle(float x) : r{x} {}
+  float area() const override { return 3.14159f * r * r; }
+};
+struct v_square : shape {
+  float a;
+  v_square(float x) : a{x} {}
+  float area() const override { return a * a; }
+};
+struct v_rect : shape {
+  float w, h;
+  v_rect(float x) : w{x}, h{x + 1} {}
+  float area() const override { return w * h; }
+};
+
+std::vector<int> random_kinds() {
+  std::mt19937 rng{42};
+  std::vector<int> r(elements);
+  for (auto &k : r)
+    k = rng() % 3;
+  return r;
+}
+
+void bench_hetero(const std::vector<int> &kinds) {
+  using chain_t = hetero_chain<circle, square, rect>;
+  chain_t ch;
+  std::vector<chain_t::segment<circle>> circles;
+  std::vector<chain_t::segment<square>> squares;
+  std::vector<chain_t::segment<rect>> rects;
+  circles.reserve(elements);
+  squares.reserve(elements);
+  rects.reserve(elements);
+  for (size_t i = 0; i < elements; i++) {
+    float x = float(i % 7);
+    if (kinds[i] == 0)
+      ch.link_back(circles.emplace_back(circle{x}));
+    else if (kinds[i] == 1)
+      ch.link_back(squares.emplace_back(square{x}));
+    else
+      ch.link_back(rects.emplace_back(rect{x, x + 1}));
+  }
+
+  measure("hetero_chain visit", iterations, elements, [&]() {
+    float sum = 0;
+    ch.visit([&](const auto &s) {
+      using T = std::decay_t<decltype(s)>;
+      if constexpr (std::is_same_v<T, circle>)
+        sum += 3.14159f * s.r * s.r;
+      else if constexpr (std::is_same_v<T, square>)
+        sum += s.a * s.a;
+      else
+        sum += s.w * s.h;
+    });
+    do_not_optimize(sum);
+  });
+}
+
+void bench_virtual(const std::vector<int> &kinds) {
+  std::list<std::unique_ptr<shape>> shapes;
+  for (size_t i = 0; i < elements; i++) {
+    float x = float(i % 7);
+    if (kinds[i] == 0)
+      shapes.push_back(std::make_unique<v_circle>(x));
+    else if (kinds[i] == 1)
+      shapes.push_back(std::make_unique<v_square>(x));
+    else
+      shapes.push_back(std::make_unique<v_rect>(x));
+  }
+
+  measure("std::list<std::unique_ptr<shape>> virtual", iterations, elements, [&]() {
+    float sum = 0;
+    for (const auto &s : shapes)
+      sum += s->area();
+    do_not_optimize(sum);
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  auto kinds = random_kinds();
+  bench_hetero(kinds);
+  bench_virtual(kinds);
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "hardwave/heapfree/chain.hpp"
+#include "hardwave/heapfree/indexed_chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t lookups = 1000;
+
+std::vector<size_t> random_indices(size_t elements) {
+  std::mt19937 rng{42};
+  std::vector<size_t> r(lookups);
+  for (auto &i : r)
+    i = rng() % elements;
+  return r;
+}
+
+void bench_chain(size_t elements) {
+  chain<int> ch;
+  std::vector<chain<int>::segment> segs(elements);
+  for (auto &s : segs)
+    ch.link_back(s);
+  auto idx = random_indices(elements);
+
+  char name[64];
+  std::snprintf(name, sizeof(name), "chain operator[] (%zu)", elements);
+  measure(name, 5, lookups, [&]() {
+    for (auto i : idx)
+      do_not_optimize(ch[i]);
+  });
+}
+
+void bench_indexed(size_t elements) {
+  using chain_t = indexed_chain<int>;
+  chain_t ch;
+  std::vector<chain_t::segment> segs(elements);
+  for (auto &s : segs)
+    ch.link_back(s);
+  auto idx = random_indices(elements);
+
+  char name[64];
+  std::snprintf(name, sizeof(name), "indexed_chain operator[] (%zu)", elements);
+  measure(name, 100, lookups, [&]() {
+    for (auto i : idx)
+      do_not_optimize(ch[i]);
+  });
+
+  std::snprintf(name, sizeof(name), "indexed_chain index_of (%zu)", elements);
+  measure(name, 100, lookups, [&]() {
+    for (auto i : idx)
+      do_not_optimize(ch.index_of(segs[i]));
+  });
+
+  std::snprintf(name, sizeof(name), "indexed_chain unlink + link_at (%zu)", elements);
+  measure(name, 100, lookups, [&]() {
+    for (auto i : idx) {
+      auto &s = segs[i];
+      s.unlink();
+      ch.link_at(i, s);
+    }
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  for (size_t elements : {size_t{1} << 10, size_t{1} << 14, size_t{1} << 18}) {
+    bench_chain(elements);
+    bench_indexed(elements);
+  }
+  return 0;
+}
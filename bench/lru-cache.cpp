@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <list>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include "hardwave/heapfree/lru_cache.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t capacity = 1 << 14;
+constexpr unsigned key_space = 1 << 17;
+constexpr size_t requests = 1 << 20;
+
+// Skewed towards small keys: the minimum of three uniform draws
+std::vector<unsigned> random_requests() {
+  std::mt19937 rng{42};
+  std::vector<unsigned> r(requests);
+  for (auto &k : r)
+    k = std::min({rng() % key_space, rng() % key_space, rng() % key_space});
+  return r;
+}
+
+void bench_lru_cache(const std::vector<unsigned> &reqs) {
+  // The value is the slot the entry is stored in, so evicted entries
+  // can be reused
+  using cache_t = lru_cache<unsigned, unsigned, capacity>;
+  static cache_t cache{capacity};
+  static std::vector<std::optional<cache_t::entry>> slots(capacity);
+  unsigned used = 0;
+
+  measure("lru_cache get / insert on miss", 5, std::size(reqs), [&]() {
+    for (auto k : reqs) {
+      if (cache.get(k))
+        continue;
+      unsigned slot = used < capacity ? used++ : cache.evict_lru()->value();
+      slots[slot].reset();
+      cache.insert(slots[slot].emplace(k, slot));
+    }
+  });
+  std::printf("%-48s %10.3f\n", "lru_cache hit rate",
+      double(cache.hits()) / double(cache.hits() + cache.misses()));
+}
+
+void bench_std(const std::vector<unsigned> &reqs) {
+  std::list<std::pair<unsigned, unsigned>> recent;
+  std::unordered_map<unsigned, decltype(recent)::iterator> index;
+  index.reserve(capacity);
+  size_t hits = 0, misses = 0;
+
+  measure("std::list + std::unordered_map get / insert", 5, std::size(reqs), [&]() {
+    for (auto k : reqs) {
+      auto it = index.find(k);
+      if (it != index.end()) {
+        hits++;
+        recent.splice(recent.begin(), recent, it->second);
+        continue;
+      }
+      misses++;
+      if (std::size(recent) >= capacity) {
+        index.erase(recent.back().first);
+        recent.pop_back();
+      }
+      recent.emplace_front(k, k);
+      index.emplace(k, recent.begin());
+    }
+  });
+  std::printf("%-48s %10.3f\n", "std hit rate", double(hits) / double(hits + misses));
+}
+
+} // anonymous namespace
+
+int main() {
+  auto reqs = random_requests();
+  bench_lru_cache(reqs);
+  bench_std(reqs);
+  return 0;
+}
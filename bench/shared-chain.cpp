@@ -0,0 +1,106 @@
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "hardwave/heapfree/chain.hpp"
+#include "hardwave/heapfree/compact_chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t elements = 1 << 14;
+constexpr size_t iterations = 2000;
+constexpr size_t batches = 2000;
+
+using sch_t = shared_chain<long>;
+
+struct region_layout {
+  std::atomic<unsigned> full{0};
+  sch_t ch;
+  typename sch_t::segment segs[elements];
+};
+
+template<typename Chain, typename Segs>
+void bench_traversal(const char *name, Chain &ch, Segs &segs) {
+  for (auto &seg : segs) {
+    *seg = 1;
+    ch.link_back(seg);
+  }
+  measure(name, iterations, elements, [&]() {
+    long sum = 0;
+    for (const auto &v : ch)
+      sum += v;
+    do_not_optimize(sum);
+  });
+  ch.clear();
+}
+
+void wait_for(std::atomic<unsigned> &flag, unsigned v) {
+  while (flag.load(std::memory_order_acquire) != v)
+    sched_yield();
+}
+
+// Producer process links a batch of segments, the consumer process
+// iterates over them and then empties the chain again.
+void bench_handoff(region_layout &r) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    long sum = 0;
+    for (size_t b = 0; b < batches; b++) {
+      wait_for(r.full, 1);
+      for (const auto &v : r.ch)
+        sum += v;
+      r.ch.clear();
+      r.full.store(0, std::memory_order_release);
+    }
+    do_not_optimize(sum);
+    _exit(0);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t b = 0; b < batches; b++) {
+    wait_for(r.full, 0);
+    for (auto &seg : r.segs) {
+      *seg = b;
+      r.ch.link_back(seg);
+    }
+    r.full.store(1, std::memory_order_release);
+  }
+  wait_for(r.full, 0);
+  auto end = std::chrono::steady_clock::now();
+  waitpid(pid, nullptr, 0);
+
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::printf("%-48s %10.3f ns/op\n", "cross process link + traverse shared_chain",
+      double(ns) / double(batches) / double(elements));
+}
+
+} // anonymous namespace
+
+int main() {
+  void *mem = mmap(nullptr, sizeof(region_layout), PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    std::perror("mmap");
+    return 1;
+  }
+  auto *r = new (mem) region_layout{};
+
+  chain<long> ch;
+  std::vector<typename chain<long>::segment> segs(elements);
+  bench_traversal("traversal chain in private memory", ch, segs);
+  bench_traversal("traversal shared_chain in shared memory", r->ch, r->segs);
+  bench_handoff(*r);
+
+  r->~region_layout();
+  munmap(mem, sizeof(region_layout));
+  return 0;
+}
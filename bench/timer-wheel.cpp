@@ -0,0 +1,45 @@
+#include <vector>
+#include "hardwave/heapfree/timer_wheel.hpp"
+#include "timers.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr unsigned step = 16; // Ticks per advance()
+
+size_t fired = 0;
+
+void bench_timer_wheel(const timer_workload &w) {
+  using wheel_t = timer_wheel<>;
+  std::vector<wheel_t::timer> ts;
+  ts.reserve(w.size());
+  for (size_t i = 0; i < w.size(); i++)
+    ts.emplace_back([](wheel_t::timer &) { fired++; });
+
+  measure("timer_wheel arm / cancel / advance", 10, w.size(), [&]() {
+    wheel_t wheel;
+    for (size_t i = 0; i < w.size(); i++)
+      wheel.arm(ts[i], w.deadlines[i]);
+    for (size_t i = 0; i < w.size(); i++)
+      if (w.cancel[i])
+        ts[i].cancel();
+    for (unsigned now = step; now <= w.horizon; now += step)
+      wheel.advance(now);
+  });
+  do_not_optimize(fired);
+}
+
+} // anonymous namespace
+
+int main() {
+  // Timeouts with random deadlines up to 2^16 ticks away; nine out of
+  // ten are cancelled before they expire, as is usual for e.g. network
+  // timeouts
+  auto w = random_timer_workload(1000000, 1 << 16, 90);
+  bench_timer_wheel(w);
+  bench_heap_chain(w, 10, step);
+  bench_priority_queue(w, 10, step);
+  return 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <queue>
+#include <random>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include "hardwave/heapfree/heap_chain.hpp"
+#include "bench.hpp"
+
+namespace hardwave {
+namespace heapfree {
+namespace bench {
+
+/// Timers for the scheduling benchmarks: Each has a deadline in
+/// [1, horizon] and may be cancelled before it expires.
+struct timer_workload {
+  unsigned horizon;
+  std::vector<unsigned> deadlines;
+  std::vector<bool> cancel;
+
+  size_t size() const { return deadlines.size(); }
+};
+
+/// Random deadlines; each timer is cancelled with the given probability
+/// (in percent)
+inline timer_workload random_timer_workload(size_t timers, unsigned horizon, unsigned cancel_percent) {
+  std::mt19937 rng{42};
+  timer_workload w{horizon, {}, {}};
+  for (size_t i = 0; i < timers; i++) {
+    w.deadlines.push_back(1 + rng() % horizon);
+    w.cancel.push_back(rng() % 100 < cancel_percent);
+  }
+  return w;
+}
+
+/// Push all timers, cancel some, then pop the expired ones while moving
+/// the time forward by `step` ticks at a time up to the horizon.
+inline void bench_heap_chain(const timer_workload &w, size_t iterations, unsigned step) {
+  using heap_t = heap_chain<unsigned, std::greater<>>;
+  std::vector<heap_t::segment> segs;
+  segs.reserve(w.size());
+  for (auto d : w.deadlines)
+    segs.emplace_back(d);
+
+  measure("heap_chain push / cancel / pop", iterations, w.size(), [&]() {
+    heap_t h;
+    for (auto &s : segs)
+      h.push(s);
+    for (size_t i = 0; i < w.size(); i++)
+      if (w.cancel[i])
+        segs[i].unlink();
+    for (unsigned now = step; now <= w.horizon; now += step)
+      while (!h.empty() && h.top() <= now)
+        do_not_optimize(*h.pop());
+  });
+}
+
+/// Same as bench_heap_chain(), but cancelled timers are only marked and
+/// skipped when they reach the top of the queue.
+inline void bench_priority_queue(const timer_workload &w, size_t iterations, unsigned step) {
+  using entry = std::pair<unsigned, size_t>; // deadline, timer id
+  std::vector<bool> cancelled(w.size());
+
+  measure("std::priority_queue lazy deletion", iterations, w.size(), [&]() {
+    std::priority_queue<entry, std::vector<entry>, std::greater<>> q;
+    for (size_t i = 0; i < w.size(); i++) {
+      cancelled[i] = false;
+      q.emplace(w.deadlines[i], i);
+    }
+    for (size_t i = 0; i < w.size(); i++)
+      if (w.cancel[i])
+        cancelled[i] = true;
+    for (unsigned now = step; now <= w.horizon; now += step) {
+      while (!q.empty() && q.top().first <= now) {
+        auto [deadline, id] = q.top();
+        q.pop();
+        if (!cancelled[id])
+          do_not_optimize(deadline);
+      }
+    }
+  });
+}
+
+} // namespace bench
+} // namespace heapfree
+} // namespace hardwave
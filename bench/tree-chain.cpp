@@ -0,0 +1,90 @@
+#include <map>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "hardwave/heapfree/skip_chain.hpp"
+#include "hardwave/heapfree/tree_chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+std::vector<int> random_keys(size_t elements) {
+  std::mt19937 rng{42};
+  std::vector<int> r(elements);
+  for (auto &k : r)
+    k = static_cast<int>(rng());
+  return r;
+}
+
+// Insert all keys, look each one up and erase them again in the
+// order they were inserted
+void bench_tree(const std::vector<int> &keys) {
+  using chain_t = tree_chain<int, int>;
+  std::vector<chain_t::segment> segs;
+  segs.reserve(std::size(keys));
+  for (auto k : keys)
+    segs.emplace_back(k, k);
+
+  char name[64];
+  std::snprintf(name, sizeof(name), "tree_chain insert/find/erase (%zu)", std::size(keys));
+  measure(name, 10, std::size(keys), [&]() {
+    chain_t ch;
+    for (auto &s : segs)
+      ch.insert(s);
+    for (auto k : keys)
+      do_not_optimize(ch.lower_bound(k)->second);
+    for (auto &s : segs)
+      s.unlink();
+  });
+}
+
+void bench_skip(const std::vector<int> &keys) {
+  using chain_t = skip_chain<int, int>;
+  std::vector<chain_t::segment> segs;
+  segs.reserve(std::size(keys));
+  for (auto k : keys)
+    segs.emplace_back(k, k);
+
+  char name[64];
+  std::snprintf(name, sizeof(name), "skip_chain insert/find/erase (%zu)", std::size(keys));
+  measure(name, 10, std::size(keys), [&]() {
+    chain_t ch;
+    for (auto &s : segs)
+      ch.insert(s);
+    for (auto k : keys)
+      do_not_optimize(ch.lower_bound(k)->second);
+    for (auto &s : segs)
+      s.unlink();
+  });
+}
+
+void bench_map(const std::vector<int> &keys) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "std::multimap insert/find/erase (%zu)", std::size(keys));
+  measure(name, 10, std::size(keys), [&]() {
+    std::multimap<int, int> m;
+    std::vector<std::multimap<int, int>::iterator> its;
+    its.reserve(std::size(keys));
+    for (auto k : keys)
+      its.push_back(m.emplace(k, k));
+    for (auto k : keys)
+      do_not_optimize(m.lower_bound(k)->second);
+    for (auto it : its)
+      m.erase(it);
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  for (size_t elements : {size_t{1} << 10, size_t{1} << 14, size_t{1} << 18}) {
+    auto keys = random_keys(elements);
+    bench_tree(keys);
+    bench_map(keys);
+    bench_skip(keys);
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <vector>
+#include "hardwave/heapfree/chain.hpp"
+#include "hardwave/heapfree/unrolled_chain.hpp"
+#include "bench.hpp"
+
+using namespace hardwave::heapfree;
+using namespace hardwave::heapfree::bench;
+
+namespace {
+
+constexpr size_t elements = 1 << 16;
+constexpr size_t iterations = 500;
+
+void bench_chain() {
+  chain<int> ch;
+  std::vector<chain<int>::segment> segs(elements);
+  for (auto &seg : segs) {
+    *seg = 1;
+    ch.link_back(seg);
+  }
+
+  measure("traversal chain<int>", iterations, elements, [&]() {
+    long sum = 0;
+    for (const auto &v : ch)
+      sum += v;
+    do_not_optimize(sum);
+  });
+
+  measure("traversal chain<int> lean_values", iterations, elements, [&]() {
+    long sum = 0;
+    for (const auto &v : ch.lean_values())
+      sum += v;
+    do_not_optimize(sum);
+  });
+}
+
+template<size_t N>
+void bench_unrolled(const char *iter_name, const char *for_each_name) {
+  using chain_t = unrolled_chain<int, N>;
+  chain_t ch;
+  std::vector<typename chain_t::segment> segs(elements / N);
+  auto seg = segs.begin();
+  for (size_t i = 0; i < elements; i++) {
+    if (!ch.try_push_back(1)) {
+      ch.link_back(*seg++);
+      ch.push_back(1);
+    }
+  }
+
+  measure(iter_name, iterations, elements, [&]() {
+    long sum = 0;
+    for (const auto &v : ch)
+      sum += v;
+    do_not_optimize(sum);
+  });
+
+  measure(for_each_name, iterations, elements, [&]() {
+    long sum = 0;
+    ch.for_each([&](int v) { sum += v; });
+    do_not_optimize(sum);
+  });
+}
+
+} // anonymous namespace
+
+int main() {
+  std::printf("%-48s %10zu bytes\n", "chain<int> segment size",
+      sizeof(chain<int>::segment));
+  std::printf("%-48s %10zu bytes\n", "unrolled_chain<int, 16> segment size",
+      sizeof(unrolled_chain<int, 16>::segment));
+
+  bench_chain();
+  bench_unrolled<4>("traversal unrolled_chain<int, 4>",
+      "traversal unrolled_chain<int, 4> for_each");
+  bench_unrolled<16>("traversal unrolled_chain<int, 16>",
+      "traversal unrolled_chain<int, 16> for_each");
+  bench_unrolled<64>("traversal unrolled_chain<int, 64>",
+      "traversal unrolled_chain<int, 64> for_each");
+  return 0;
+}
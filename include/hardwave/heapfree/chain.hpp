@@ -1,5 +1,6 @@
 #pragma once
 #include <utility>
+#include <functional>
 #include <iterator>
 #include <type_traits>
 #include "hardwave/heapfree/meta.hpp"
@@ -9,8 +10,71 @@
 namespace hardwave {
 namespace heapfree {
 
+/// Chain option: Keep track of the number of segments linked into
+/// the chain, so `size()` becomes O(1).
+///
+/// Segments of counted chains store a pointer to the chain they are
+/// linked into, so they can update the count when they unlink themselves.
+/// This makes segments one pointer larger and moving/swapping a counted
+/// chain O(N), since those pointers need to be updated.
+///
+/// ```
+/// chain<int, counted> my_chain;
+/// ```
+struct counted {};
+
+/// Chain option: Segments store a pointer to the chain they are linked
+/// into. This makes `contains()` and creating iterators from segments
+/// (`make_chain_it()`) O(1) instead of O(N).
+///
+/// Just like with `counted`, segments become one pointer larger and
+/// moving/swapping the chain becomes O(N). Counted chains always
+/// track their owner.
+///
+/// ```
+/// chain<int, tracked> my_chain;
+/// ```
+struct tracked {};
+
+/// Chain option: All contract checks (`HEAPFREE_ASSERT`) in chains,
+/// chain segments and chain iterators are performed. This is the default.
+struct checked {};
+
+/// Chain option: Contract checks are only performed if `NDEBUG` is not
+/// defined; in release builds this behaves like `unchecked`.
+struct debug_only {};
+
+/// Chain option: No contract checks are performed at all; iterating
+/// over the chain compiles down to a plain `p = p->next` loop.
+///
+/// Violating a contract (e.g. incrementing the end iterator) is
+/// undefined behaviour in this mode.
+struct unchecked {};
+
 namespace detail {
 
+template<typename Opt, typename... Opts>
+constexpr bool has_chain_option = (std::is_same_v<Opt, Opts> || ...);
+
+template<typename... Opts>
+constexpr bool chain_checks_enabled() {
+  static_assert(has_chain_option<checked, Opts...>
+      + has_chain_option<debug_only, Opts...>
+      + has_chain_option<unchecked, Opts...> <= 1,
+      "Only one check policy may be given for chains.");
+  if constexpr (has_chain_option<unchecked, Opts...>) {
+    return false;
+  } else if constexpr (has_chain_option<debug_only, Opts...>) {
+#ifdef NDEBUG
+    return false;
+#else
+    return true;
+#endif
+  } else {
+    return true;
+  }
+}
+
 enum class chain_iterator_mode {
   values, segments, ptrs
 };
@@ -18,6 +82,9 @@ enum class chain_iterator_mode {
 template<typename, bool, chain_iterator_mode Mode>
 class chain_iterator;
 
+template<typename, bool, chain_iterator_mode Mode>
+class chain_lean_iterator;
+
 struct chain_ptr {
   chain_ptr *next{nullptr}, *prev{nullptr};
 
@@ -30,6 +97,36 @@ struct chain_ptr {
   }
 };
 
+/// Storage for the segment -> chain back pointer; empty unless
+/// the chain needs to know which segments it owns.
+template<typename Chain, bool Enabled>
+struct chain_owner_ptr {
+  Chain* owner() const { return nullptr; }
+  void set_owner(Chain*) {}
+};
+
+template<typename Chain>
+struct chain_owner_ptr<Chain, true> {
+  Chain *own{nullptr};
+
+  Chain* owner() const { return own; }
+  void set_owner(Chain *c) { own = c; }
+};
+
+/// Storage for the number of segments in a chain; empty
+/// unless the chain is counted.
+template<bool Enabled>
+struct chain_counter {
+  void add_count(std::ptrdiff_t) {}
+};
+
+template<>
+struct chain_counter<true> {
+  size_t count{0};
+
+  void add_count(std::ptrdiff_t d) { count += d; }
+};
+
 /// This type stores the actual data contained in chains.
 /// The type for a specific chain can be accessed through
 /// `decltype(chain)::segment`. The user constructs and
@@ -39,11 +136,16 @@ struct chain_ptr {
 ///
 /// Chain segments are unlinked from their chain, when they go out of scope.
 template<typename Chain>
-class chain_segment : private chain_ptr {
+class chain_segment : private chain_ptr,
+    private chain_owner_ptr<Chain, Chain::tracks_owner> {
   HEAPFREE_DECLARE_ME_SUPER(chain_segment<Chain>, chain_ptr)
+  using owner_t = chain_owner_ptr<Chain, Chain::tracks_owner>;
 
   typename Chain::value_type payload;
 
+  owner_t& owner_ptr() { return static_cast<owner_t&>(me()); }
+  const owner_t& owner_ptr() const { return static_cast<const owner_t&>(me()); }
+
   void fix_foreign_links() {
     if (!is_linked()) return;
     next->prev = &ptrs();
@@ -54,6 +156,8 @@ public:
 
   template<typename, bool, detail::chain_iterator_mode>
   friend class detail::chain_iterator;
+  template<typename, bool, detail::chain_iterator_mode>
+  friend class detail::chain_lean_iterator;
   friend chain_type;
   friend typename chain_type::iterator;
 
@@ -65,16 +169,20 @@ public:
   /// Chain segments can be move constructed.
   /// In this case the payload AND the links are moved,
   /// the source segment is UNLINKED.
-  chain_segment(me_t &&otr) : super_t{otr.super()}, payload{std::move(otr.payload)} {
+  chain_segment(me_t &&otr)
+      : super_t{otr.super()}, owner_t{otr.owner_ptr()}, payload{std::move(otr.payload)} {
     otr.next = otr.prev = nullptr;
+    otr.set_owner(nullptr);
     fix_foreign_links();
   }
   chain_segment& operator=(me_t &&otr) {
     if (is_linked())
       unlink();
     super() = otr.super();
+    owner_ptr() = otr.owner_ptr();
     payload = std::move(otr.payload);
     otr.next = otr.prev = nullptr;
+    otr.set_owner(nullptr);
     fix_foreign_links();
     return me();
   }
@@ -103,6 +211,7 @@ public:
   /// Swapping swaps both the payload AND the links
   void swap(me_t &otr) {
     std::swap(super(), otr.super());
+    std::swap(owner_ptr(), otr.owner_ptr());
     std::swap(payload, otr.payload);
     fix_foreign_links();
     otr.fix_foreign_links();
@@ -124,10 +233,14 @@ public:
   }
 
   void unlink() {
-    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a segment that is not linked.");
+    HEAPFREE_ASSERT_IF(Chain::checks_enabled, is_linked(),
+        "Cannot unlink a segment that is not linked.");
     next->prev = prev;
     prev->next = next;
     next = prev = nullptr;
+    if constexpr (Chain::is_counted)
+      owner_ptr().owner()->add_count(-1);
+    owner_ptr().set_owner(nullptr);
   }
 };
 
@@ -167,17 +280,8 @@ class chain_iterator :
     return chain_iterator{ch, ch.ptrs()};
   }
 
-  bool chain_is_valid() {
-    if (pt->next == nullptr)
-      return false;
-    for (chain_ptr *p{pt->next}; true; p = p->next) {
-      if (p == pt) return false;
-      if (p == &ch->ptrs()) return true;
-    }
-  }
-
   void assert_nonull(std::string_view activity) const {
-    HEAPFREE_ASSERT(pt != nullptr && ch != nullptr,
+    HEAPFREE_ASSERT_IF(Chain::checks_enabled, pt != nullptr && ch != nullptr,
         "Cannot ", activity, " a null chain operator");
   }
 
@@ -198,11 +302,12 @@ public:
 
   /// When creating an iterator from a segment, the constructor
   /// checks that the segment is actually part of the given chain.
-  /// This is accomplished in O(N).
+  /// This is accomplished in O(N), or O(1) if the chain tracks the
+  /// owners of its segments (see `tracked`).
   /// If you are absolutely sure, the segment IS part of that chain,
   /// and the check is not necessary, unsafe_create can be used.
   chain_iterator(chain_t &c, seg_t &seg) : me_t{c, seg.ptrs()} {
-    HEAPFREE_ASSERT(chain_is_valid(), "Trying to create a chain ",
+    HEAPFREE_ASSERT_IF(Chain::checks_enabled, c.contains(seg), "Trying to create a chain ",
         "iterator with a segment that is not part of that chain?");
   }
 
@@ -252,7 +357,8 @@ public:
   /// a chain-value iterator
   seg_t& segment() {
     assert_nonull("dereference");
-    HEAPFREE_ASSERT(!is_end(), "Cannot dereference chain iterator: its at the end");
+    HEAPFREE_ASSERT_IF(Chain::checks_enabled, !is_end(),
+        "Cannot dereference chain iterator: its at the end");
     return static_cast<seg_t&>(ptrs());
   }
   const seg_t& segment() const {
@@ -261,7 +367,8 @@ public:
 
   /// Return the value this iterator points to, even if the iterator is
   /// a chain-segment iterator
-  typename chain_t::reference value() { return segment().value(); }
+  std::conditional_t<Const, typename chain_t::const_reference, typename chain_t::reference>
+  value() { return segment().value(); }
   typename chain_t::const_reference value() const { return segment().value(); }
 
   auto& operator*() {
@@ -283,12 +390,14 @@ public:
   me_t& operator--() {
     assert_nonull("decrement");
     pt = pt->prev;
-    HEAPFREE_ASSERT(!is_end(), "Can not decrement begin() iterator.");
+    HEAPFREE_ASSERT_IF(Chain::checks_enabled, !is_end(),
+        "Can not decrement begin() iterator.");
     return me();
   }
   me_t& operator++() {
     assert_nonull("increment");
-    HEAPFREE_ASSERT(!is_end(), "Can not increment end() iterator.");
+    HEAPFREE_ASSERT_IF(Chain::checks_enabled, !is_end(),
+        "Can not increment end() iterator.");
     pt = pt->next;
     return me();
   }
@@ -305,9 +414,15 @@ public:
     return r;
   }
 
+  /// Two iterators at the same node are always part of the same chain;
+  /// the chain is only compared to catch mixups with default constructed
+  /// iterators and is skipped if checks are disabled.
   template<bool Const2>
   bool operator==(const chain_iterator<Chain, Const2, Mode> &otr) const {
-    return otr.ch == ch && otr.pt == pt;
+    if constexpr (Chain::checks_enabled)
+      return otr.ch == ch && otr.pt == pt;
+    else
+      return otr.pt == pt;
   }
 
   template<typename T>
@@ -316,6 +431,155 @@ public:
   }
 };
 
+/// End marker for chain_lean_iterator.
+/// Holds the chain header; an iterator is at the end, if it
+/// points to the header.
+template<typename Chain>
+class chain_sentinel {
+  friend Chain;
+  template<typename, bool, detail::chain_iterator_mode>
+  friend class detail::chain_lean_iterator;
+
+  const chain_ptr *head{nullptr};
+
+  explicit chain_sentinel(const chain_ptr &h) : head{&h} {}
+
+public:
+  chain_sentinel() = default;
+};
+
+/// Single pointer iterator over chains.
+/// Returned by lean_values() and lean_segments(), together with a
+/// chain_sentinel as the end marker.
+///
+/// Unlike chain_iterator, this iterator does not know which chain it
+/// belongs to: It is half the size and each step does not need to
+/// compare against the chain header, but it can not check whether it
+/// is being dereferenced, incremented or decremented past the ends of
+/// the chain (apart from a null check). In a loop it compiles to about
+/// the same code as chain_iterator with the `unchecked` policy; it is
+/// not any faster than that.
+///
+/// Validity rules are the same as for chain_iterator.
+template<typename Chain, bool Const, chain_iterator_mode Mode = chain_iterator_mode::values>
+class chain_lean_iterator {
+  using me_alias = chain_lean_iterator<Chain, Const, Mode>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  static_assert(Mode != chain_iterator_mode::ptrs,
+      "Lean chain iterators can only iterate over values and segments.");
+
+  template<typename, bool, detail::chain_iterator_mode>
+  friend class detail::chain_lean_iterator;
+  friend Chain;
+
+  using chain_t = std::conditional_t<Const, const Chain, Chain>;
+  using seg_t = std::conditional_t<Const, const typename chain_t::segment, typename chain_t::segment>;
+  using ptr_t = std::conditional_t<Const, const chain_ptr, chain_ptr>;
+
+  ptr_t *pt{nullptr};
+
+  explicit chain_lean_iterator(ptr_t &p) : pt{&p} {}
+
+  bool is_at(const chain_sentinel<Chain> &s) const {
+    return pt == s.head;
+  }
+
+  // Takes the literal itself: a string_view would be spilled to the
+  // stack on every step of a loop whose body calls opaque functions
+  template<size_t N>
+  void assert_nonull(const char (&activity)[N]) const {
+    HEAPFREE_ASSERT_IF(Chain::checks_enabled, pt != nullptr,
+        "Cannot ", activity, " a null chain operator");
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type =
+    std::conditional_t<Mode == chain_iterator_mode::values,
+      typename chain_t::value_type, typename chain_t::segment>;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  chain_lean_iterator() = default;
+
+  template<bool Const2>
+  chain_lean_iterator(const chain_lean_iterator<Chain, Const2, Mode> &otr) : pt{otr.pt} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  /// Return the segment this iterator points to, even if the iterator is
+  /// a chain-value iterator
+  seg_t& segment() const {
+    assert_nonull("dereference");
+    return static_cast<seg_t&>(*pt);
+  }
+
+  /// Return the value this iterator points to, even if the iterator is
+  /// a chain-segment iterator
+  std::conditional_t<Const, typename Chain::const_reference, typename Chain::reference>
+  value() const {
+    return segment().value();
+  }
+
+  reference operator*() const {
+    if constexpr(Mode == chain_iterator_mode::values)
+      return value();
+    else
+      return segment();
+  }
+
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator--() {
+    assert_nonull("decrement");
+    pt = pt->prev;
+    return me();
+  }
+  me_t& operator++() {
+    assert_nonull("increment");
+    pt = pt->next;
+    return me();
+  }
+
+  me_t operator--(int) {
+    me_t r{me()};
+    --me();
+    return r;
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const chain_lean_iterator<Chain, Const2, Mode> &otr) const {
+    return otr.pt == pt;
+  }
+
+  template<bool Const2>
+  bool operator!=(const chain_lean_iterator<Chain, Const2, Mode> &otr) const {
+    return otr.pt != pt;
+  }
+
+  friend bool operator==(const me_t &it, const chain_sentinel<Chain> &s) {
+    return it.is_at(s);
+  }
+  friend bool operator==(const chain_sentinel<Chain> &s, const me_t &it) {
+    return it.is_at(s);
+  }
+  friend bool operator!=(const me_t &it, const chain_sentinel<Chain> &s) {
+    return !it.is_at(s);
+  }
+  friend bool operator!=(const chain_sentinel<Chain> &s, const me_t &it) {
+    return !it.is_at(s);
+  }
+};
+
 } // namespace detail
 
 /// A chain is a linked list that does not manage it's own memory,
@@ -379,6 +643,10 @@ public:
 ///
 /// # Type erasure using chains
 ///
+/// (intrusive_chain supports this pattern directly: The objects derive
+/// from a common base containing the hook, and iteration yields references
+/// to that base without any casts. See intrusive_chain.hpp.)
+///
 /// An added advantage of this structure is that each segment could
 /// contain a different type, without needing to support actual runtime polymorphism (vtables).
 /// The event class uses is to store various
@@ -424,16 +692,48 @@ public:
 ///   }
 /// }
 /// ```
-template<typename T>
-class chain : private detail::chain_ptr {
-  HEAPFREE_DECLARE_ME_SUPER(chain<T>, detail::chain_ptr)
+///
+/// # Options
+///
+/// Further template parameters can be used to select chain options:
+///
+/// * `counted` – keep track of the number of segments; `size()` is O(1)
+/// * `tracked` – segments know their chain; `contains()` is O(1)
+/// * `checked` (default), `debug_only`, `unchecked` – whether contract
+///   checks are performed
+template<typename T, typename... Opts>
+class chain : private detail::chain_ptr,
+    private detail::chain_counter<detail::has_chain_option<counted, Opts...>> {
+  using me_alias = chain<T, Opts...>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, detail::chain_ptr)
+  using counter_t = detail::chain_counter<detail::has_chain_option<counted, Opts...>>;
 
   // does not work if the chain is empty!
   void fix_moved_ptrs() {
     next->prev = prev->next = &ptrs();
   }
 
+  // Point the owner pointers of all segments back at this chain
+  void fix_owners() {
+    if constexpr (tracks_owner) {
+      for (auto &seg : segments())
+        seg.set_owner(&me());
+    }
+  }
+
 public:
+  /// Whether this chain keeps track of its size; see `counted`
+  static constexpr bool is_counted = detail::has_chain_option<counted, Opts...>;
+
+  /// Whether segments store a pointer to the chain they are linked into;
+  /// see `tracked`
+  static constexpr bool tracks_owner = is_counted
+    || detail::has_chain_option<tracked, Opts...>;
+
+  /// Whether contract checks are performed; see `checked`, `debug_only`
+  /// and `unchecked`
+  static constexpr bool checks_enabled = detail::chain_checks_enabled<Opts...>();
+
   using value_type      = T;
   using size_type       = size_t;
   using difference_type = std::ptrdiff_t;
@@ -450,8 +750,15 @@ public:
 
   template<typename, bool, detail::chain_iterator_mode>
   friend class detail::chain_iterator;
+  template<typename, bool, detail::chain_iterator_mode>
+  friend class detail::chain_lean_iterator;
   friend segment;
 
+private:
+  counter_t& counter() { return static_cast<counter_t&>(me()); }
+  const counter_t& counter() const { return static_cast<const counter_t&>(me()); }
+
+public:
   /// At the start a chain is empty
   chain() {
     next = prev = &ptrs();
@@ -474,6 +781,8 @@ public:
       super() = otr.super();
       fix_moved_ptrs();
       otr.next = otr.prev = &otr.ptrs();
+      std::swap(counter(), otr.counter());
+      fix_owners();
     }
     return me();
   }
@@ -488,20 +797,45 @@ public:
       otr = std::move(me());
     } else {
       std::swap(super(), otr.super());
+      std::swap(counter(), otr.counter());
       fix_moved_ptrs();
       otr.fix_moved_ptrs();
+      fix_owners();
+      otr.fix_owners();
     }
   }
 
-  // Size is O(N)
-  size_t size() const { return std::distance(begin(), end()); }
+  // Size is O(N), unless the chain is counted
+  size_t size() const {
+    if constexpr (is_counted)
+      return counter().count;
+    else
+      return std::distance(begin(), end());
+  }
   bool empty() const { return next == &ptrs(); }
 
+  /// Check whether the given segment is linked into this chain.
+  /// This is O(N), unless the chain tracks the owners of its segments
+  /// (see `tracked` and `counted`).
+  bool contains(const segment &seg) const {
+    if constexpr (tracks_owner) {
+      return seg.owner_ptr().owner() == this;
+    } else {
+      const detail::chain_ptr &sp = seg.ptrs();
+      if (sp.next == nullptr)
+        return false;
+      for (const detail::chain_ptr *p{sp.next}; true; p = p->next) {
+        if (p == &sp) return false;
+        if (p == &ptrs()) return true;
+      }
+    }
+  }
+
   /// This can be used to link an existing segment into the chain.
   /// The segment must not be linked for this
   iterator link(const_iterator it, segment &seg) {
-    HEAPFREE_ASSERT(!seg.is_linked(), "");
-    HEAPFREE_ASSERT(&it.chain() == this, "");
+    HEAPFREE_ASSERT_IF(checks_enabled, !seg.is_linked(), "");
+    HEAPFREE_ASSERT_IF(checks_enabled, &it.chain() == this, "");
     auto &sis = seg.ptrs();
     auto &p = const_cast<detail::chain_ptr&>(*it.ptrs().prev);
     auto &n = const_cast<detail::chain_ptr&>(it.ptrs());
@@ -510,6 +844,8 @@ public:
     sis.next = &n;
     n.prev = &sis;
     p.next = &sis;
+    seg.set_owner(&me());
+    counter().add_count(1);
 
     return iterator::unsafe_create(me(), seg);
   }
@@ -525,12 +861,147 @@ public:
   /// Unlinks a single segment from the chain;
   /// returns an iterator just after the one that was removed.
   iterator unlink(iterator it) {
-    HEAPFREE_ASSERT(&it.chain() == &me(), "");
+    HEAPFREE_ASSERT_IF(checks_enabled, &it.chain() == &me(), "");
     auto r = std::next(it);
     it.segment().unlink();
     return r;
   }
 
+  /// Link all segments in [first, last) (e.g. an array of segments) just
+  /// before `pos`, in one pass; none of them may be linked yet.
+  /// Returns an iterator to the first linked segment (or pos if the
+  /// range is empty).
+  ///
+  /// Cheaper than repeated link() calls: The neighbour pointers are
+  /// written sequentially and no iterator is constructed per segment.
+  /// If checks are enabled, the segments are verified in a separate
+  /// pass first, so a failed check leaves the chain untouched.
+  template<typename It>
+  iterator link_range(const_iterator pos, It first, It last) {
+    HEAPFREE_ASSERT_IF(checks_enabled, &pos.chain() == this, "");
+    if constexpr (checks_enabled) {
+      for (It it{first}; it != last; ++it)
+        HEAPFREE_ASSERT(!static_cast<segment&>(*it).is_linked(),
+            "Cannot link a segment that is already linked.");
+    }
+
+    auto &n = const_cast<detail::chain_ptr&>(pos.ptrs());
+    if (first == last)
+      return {me(), n};
+
+    detail::chain_ptr *head{&static_cast<segment&>(*first).ptrs()}, *p{n.prev};
+    std::ptrdiff_t cnt{0};
+    for (; first != last; ++first, cnt++) {
+      segment &seg = *first;
+      auto &sp = seg.ptrs();
+      sp.prev = p;
+      p->next = &sp;
+      seg.set_owner(&me());
+      p = &sp;
+    }
+    p->next = &n;
+    n.prev = p;
+    counter().add_count(cnt);
+    return {me(), *head};
+  }
+
+  /// Link all segments in the given range (e.g. an array) just before pos
+  template<typename Range>
+  iterator link_range(const_iterator pos, Range &&segs) {
+    return link_range(pos, std::begin(segs), std::end(segs));
+  }
+
+  /// Unlink all segments in [first, last); returns an iterator to last.
+  ///
+  /// last must not come before first. If checks are enabled, this is
+  /// verified in a separate pass first, so a failed check leaves the
+  /// chain untouched; without checks, a reversed range is undefined
+  /// behaviour.
+  iterator unlink_range(const_iterator first, const_iterator last) {
+    HEAPFREE_ASSERT_IF(checks_enabled, &first.chain() == this, "");
+    HEAPFREE_ASSERT_IF(checks_enabled, &last.chain() == this, "");
+    auto &l = const_cast<detail::chain_ptr&>(last.ptrs());
+    detail::chain_ptr *cur{const_cast<detail::chain_ptr*>(&first.ptrs())}, *before{cur->prev}, *nx;
+    if constexpr (checks_enabled) {
+      for (const detail::chain_ptr *p{cur}; p != &l; p = p->next)
+        HEAPFREE_ASSERT(p != &ptrs(), "Cannot unlink range: last comes before first.");
+    }
+    std::ptrdiff_t cnt{0};
+    while (cur != &l) {
+      nx = cur->next;
+      cur->next = cur->prev = nullptr;
+      static_cast<segment*>(cur)->set_owner(nullptr);
+      cur = nx;
+      cnt++;
+    }
+    before->next = &l;
+    l.prev = before;
+    counter().add_count(-cnt);
+    return {me(), l};
+  }
+
+  /// Unlink all segments whose value matches pred, in one pass;
+  /// returns the number of segments unlinked.
+  ///
+  /// The chain is relinked on the fly without any per-segment checks;
+  /// pred must not link or unlink segments of this chain.
+  template<typename Pred>
+  size_t unlink_if(Pred pred) {
+    detail::chain_ptr *kept{&ptrs()}, *cur{next}, *nx;
+    size_t cnt{0};
+    for (; cur != &ptrs(); cur = nx) {
+      nx = cur->next;
+      auto &seg = *static_cast<segment*>(cur);
+      if (pred(seg.value())) {
+        cur->next = cur->prev = nullptr;
+        seg.set_owner(nullptr);
+        cnt++;
+      } else {
+        kept->next = cur;
+        cur->prev = kept;
+        kept = cur;
+      }
+    }
+    kept->next = &ptrs();
+    prev = kept;
+    counter().add_count(-static_cast<std::ptrdiff_t>(cnt));
+    return cnt;
+  }
+
+  /// Move all segments whose value matches pred to the end of otr, in
+  /// one pass; the order of the segments is preserved in both chains.
+  /// Returns the number of segments moved.
+  ///
+  /// Just like unlink_if(), pred must not modify either chain.
+  template<typename Pred>
+  size_t partition(Pred pred, me_t &otr) {
+    HEAPFREE_ASSERT_IF(checks_enabled, &otr != this, "Can not partition a chain into itself.");
+    detail::chain_ptr *kept{&ptrs()}, *moved{otr.prev}, *cur{next}, *nx;
+    size_t cnt{0};
+    for (; cur != &ptrs(); cur = nx) {
+      nx = cur->next;
+      auto &seg = *static_cast<segment*>(cur);
+      if (pred(seg.value())) {
+        moved->next = cur;
+        cur->prev = moved;
+        moved = cur;
+        seg.set_owner(&otr);
+        cnt++;
+      } else {
+        kept->next = cur;
+        cur->prev = kept;
+        kept = cur;
+      }
+    }
+    kept->next = &ptrs();
+    prev = kept;
+    moved->next = &otr.ptrs();
+    otr.prev = moved;
+    counter().add_count(-static_cast<std::ptrdiff_t>(cnt));
+    otr.counter().add_count(cnt);
+    return cnt;
+  }
+
   /// Unlinks *all* segments from the list
   void clear() {
     detail::chain_ptr *cur{next}, *nx;
@@ -538,8 +1009,264 @@ public:
     while (cur != &ptrs()) {
       nx = cur->next;
       cur->next = cur->prev = nullptr;
+      static_cast<segment*>(cur)->set_owner(nullptr);
       cur = nx;
     }
+    counter() = counter_t{};
+  }
+
+  /// Move the segments [first, last) from the chain `otr` into this chain,
+  /// just before `pos`. `otr` may be this chain, in which case pos must
+  /// not be inside [first, last).
+  ///
+  /// Only the pointers at the boundaries of the range are changed, so
+  /// this is O(1); unless the chains track the owners of their segments
+  /// (see `tracked` and `counted`) and otr is a different chain; then the
+  /// segments in the range need to be visited and this is O(length of range).
+  void splice(const_iterator pos, me_t &otr, const_iterator first, const_iterator last) {
+    HEAPFREE_ASSERT_IF(checks_enabled, &pos.chain() == this, "");
+    HEAPFREE_ASSERT_IF(checks_enabled, &first.chain() == &otr, "");
+    HEAPFREE_ASSERT_IF(checks_enabled, &last.chain() == &otr, "");
+    if (first == last || pos == last)
+      return;
+
+    auto &f = const_cast<detail::chain_ptr&>(first.ptrs());
+    auto &l = *const_cast<detail::chain_ptr&>(last.ptrs()).prev; // last segment in range
+    auto &n = const_cast<detail::chain_ptr&>(pos.ptrs());
+    auto &p = *n.prev;
+
+    if constexpr (tracks_owner) {
+      if (&otr != this) {
+        std::ptrdiff_t cnt{0};
+        for (detail::chain_ptr *cur{&f}; cur != l.next; cur = cur->next, cnt++)
+          static_cast<segment*>(cur)->set_owner(&me());
+        counter().add_count(cnt);
+        otr.counter().add_count(-cnt);
+      }
+    }
+
+    // Cut the range out of otr
+    f.prev->next = l.next;
+    l.next->prev = f.prev;
+
+    // Insert it before pos
+    p.next = &f;
+    f.prev = &p;
+    l.next = &n;
+    n.prev = &l;
+  }
+
+  /// Move a single segment from otr into this chain, just before pos
+  void splice(const_iterator pos, me_t &otr, const_iterator it) {
+    splice(pos, otr, it, std::next(it));
+  }
+
+  /// Move all segments from otr into this chain, just before pos
+  void splice(const_iterator pos, me_t &otr) {
+    splice(pos, otr, otr.begin(), otr.end());
+  }
+
+  /// Split the chain in two: All segments from `at` to the end
+  /// are moved into a new chain, which is returned.
+  /// O(1), unless the chain tracks its owners (see splice()).
+  [[nodiscard]] me_t split(const_iterator at) {
+    me_t r;
+    r.splice(r.end(), me(), at, end());
+    return r;
+  }
+
+  /// Merge the segments of otr into this chain; both chains must be
+  /// sorted according to cmp. The merge is stable: segments from this
+  /// chain come before equivalent segments from otr.
+  ///
+  /// Runs of consecutive segments from otr are moved using splice(), so
+  /// only O(N + M) comparisons are needed and no payloads are moved.
+  template<typename Cmp = std::less<>>
+  void merge(me_t &otr, Cmp cmp = Cmp{}) {
+    HEAPFREE_ASSERT_IF(checks_enabled, &otr != this, "Can not merge a chain into itself.");
+    auto it = begin();
+    while (!std::empty(otr)) {
+      while (it != end() && !cmp(otr.front(), *it))
+        ++it;
+      if (it == end()) {
+        splice(end(), otr);
+        return;
+      }
+      auto run = std::next(otr.begin());
+      while (run != otr.end() && cmp(*run, *it))
+        ++run;
+      splice(it, otr, otr.begin(), run);
+    }
+  }
+
+private:
+  // Implementation of sort(); less compares the links of two segments
+  template<typename Less>
+  void sort_links(Less less) {
+    using detail::chain_ptr;
+    if (next->next == &ptrs()) // Zero or one segments
+      return;
+
+    // The merge steps only use the next pointers, with nullptr
+    // terminating lists; prev pointers are restored at the end.
+    // a must hold the segments that came first in the chain.
+    auto merge = [&less](chain_ptr *a, chain_ptr *b) {
+      chain_ptr head, *tail{&head};
+      while (a != nullptr && b != nullptr) {
+        if (less(b, a)) {
+          tail->next = b;
+          b = b->next;
+        } else {
+          tail->next = a;
+          a = a->next;
+        }
+        tail = tail->next;
+      }
+      tail->next = a != nullptr ? a : b;
+      return head.next;
+    };
+
+    // runs[i] is either empty or a sorted list of 2^i segments
+    chain_ptr *runs[sizeof(size_t) * 8] = {};
+    size_t used{0};
+
+    chain_ptr *list{next};
+    prev->next = nullptr;
+    while (list != nullptr) {
+      chain_ptr *carry{list};
+      list = list->next;
+      carry->next = nullptr;
+
+      size_t i{0};
+      for (; i < used && runs[i] != nullptr; i++) {
+        carry = merge(runs[i], carry);
+        runs[i] = nullptr;
+      }
+      runs[i] = carry;
+      if (i == used)
+        used++;
+    }
+
+    // Larger runs contain the earlier segments
+    list = nullptr;
+    for (size_t i{0}; i < used; i++)
+      if (runs[i] != nullptr)
+        list = merge(runs[i], list);
+
+    chain_ptr *last{&ptrs()};
+    for (chain_ptr *cur{list}; cur != nullptr; cur = cur->next) {
+      cur->prev = last;
+      last = cur;
+    }
+    next = list;
+    prev = last;
+    last->next = &ptrs();
+  }
+
+
+public:
+  /// Sort the chain according to cmp.
+  ///
+  /// This is a stable, bottom-up merge sort: O(N log N) comparisons.
+  /// Only the links between the segments are changed; payloads are never
+  /// moved or copied, so references to values and iterators stay valid.
+  ///
+  /// The extra memory used does not depend on N: sorted runs of 2^i
+  /// segments are kept in a fixed array of one list head per bit of
+  /// size_t (512 bytes of stack on 64 bit platforms). Merging runs of
+  /// equal length as soon as they appear keeps the working set small,
+  /// which is much faster than merging in full passes over the chain.
+  template<typename Cmp = std::less<>>
+  void sort(Cmp cmp = Cmp{}) {
+    sort_links([&cmp](detail::chain_ptr *a, detail::chain_ptr *b) {
+      return cmp(static_cast<segment*>(a)->value(), static_cast<segment*>(b)->value());
+    });
+  }
+
+  /// Reorder the links, so the segments are traversed in the order
+  /// they are located in memory.
+  ///
+  /// Chains that live for a long time tend to be linked in an order
+  /// unrelated to where their segments are stored; then every step of
+  /// a traversal is a cache (and possibly TLB) miss. If the order of the
+  /// segments does not matter (e.g. event listeners), relinking them by
+  /// address lets the hardware prefetcher do its work.
+  ///
+  /// Same cost as sort(): O(N log N), no payloads are moved.
+  void relink_by_address() {
+    sort_links(std::less<const detail::chain_ptr*>{});
+  }
+
+  /// Progress of an incremental relink_by_address(); default construct
+  /// one and pass it to relink_by_address(progress, count) repeatedly.
+  class relink_progress {
+    friend me_t;
+    const_iterator a, b; // Current run (or merge position) and next run
+    bool running{false}, scanning{true}, merged{false};
+  };
+
+  /// Incremental variant of relink_by_address(): Performs at most `count`
+  /// steps (each visiting one segment) of a natural merge sort by address
+  /// and returns true once the chain is fully ordered.
+  ///
+  /// Runs of segments that are already in address order are merged using
+  /// splice(), so the chain is valid between calls, can be traversed and
+  /// segments may be linked and unlinked; merely the two segments the
+  /// progress object points to must stay linked (otherwise start over
+  /// with a fresh relink_progress).
+  ///
+  /// This buys short pauses with a lot of total work. Relinking N
+  /// segments in random order takes about 3 N log2 N steps, and each
+  /// pass walks the chain in its current, scattered order, so early
+  /// steps are mostly cache misses. For 10^6 segments that is about
+  /// 15000 calls with a count of 4096, and about ten times the total
+  /// time of relink_by_address() (6.3 vs 0.7 µs per segment). Prefer
+  /// the full relink whenever a pause of that length is acceptable.
+  bool relink_by_address(relink_progress &st, size_t count) {
+    auto lower = [](const_iterator x, const_iterator y) {
+      return std::less<const segment*>{}(&x.segment(), &y.segment());
+    };
+
+    if (!st.running) {
+      st = relink_progress{};
+      st.running = true;
+      st.a = st.b = begin();
+    }
+
+    for (; count > 0; count--) {
+      if (st.scanning) {
+        // a is the start of a run, b walks to its end
+        if (st.b == end()) {
+          if (!st.merged) {
+            st.running = false;
+            return true;
+          }
+          st.a = st.b = begin(); // Start the next pass
+          st.merged = false;
+          continue;
+        }
+        auto nx = std::next(st.b);
+        if (nx != end() && lower(nx, st.b))
+          st.scanning = false; // nx starts the run to merge into [a, nx)
+        st.b = nx;
+      } else if (lower(st.b, st.a)) {
+        // Move the head of the second run in front of a
+        auto nx = std::next(st.b);
+        bool run_continues = nx != end() && !lower(nx, st.b);
+        splice(st.a, me(), st.b);
+        st.merged = true;
+        st.b = nx;
+        if (!run_continues) {
+          st.a = nx;
+          st.scanning = true;
+        }
+      } else if (++st.a == st.b) {
+        // The first run is exhausted; the rest of the second run
+        // starts the next one
+        st.scanning = true;
+      }
+    }
+    return false;
   }
 
   /// Construct and link a segment in one go.
@@ -594,6 +1321,27 @@ public:
     using It = detail::chain_iterator<me_t, true, detail::chain_iterator_mode::segments>;
     return iterator_range{It{me(), *next}, It::create_end(me())};
   }
+
+  /// Constructs an iterator_range over the values in the chain from a
+  /// single pointer iterator and a sentinel (see detail::chain_lean_iterator).
+  auto lean_values() {
+    using It = detail::chain_lean_iterator<me_t, false>;
+    return iterator_range{It{*next}, detail::chain_sentinel<me_t>{ptrs()}};
+  }
+  auto lean_values() const {
+    using It = detail::chain_lean_iterator<me_t, true>;
+    return iterator_range{It{*next}, detail::chain_sentinel<me_t>{ptrs()}};
+  }
+
+  /// Like lean_values(), but iterates over the segments
+  auto lean_segments() {
+    using It = detail::chain_lean_iterator<me_t, false, detail::chain_iterator_mode::segments>;
+    return iterator_range{It{*next}, detail::chain_sentinel<me_t>{ptrs()}};
+  }
+  auto lean_segments() const {
+    using It = detail::chain_lean_iterator<me_t, true, detail::chain_iterator_mode::segments>;
+    return iterator_range{It{*next}, detail::chain_sentinel<me_t>{ptrs()}};
+  }
 };
 
 template<typename Chain>
@@ -616,5 +1364,49 @@ typename Chain::const_iterator unsafe_make_chain_it(const Chain &ch, const typen
   return Chain::const_iterator::unsafe_create(ch, seg);
 }
 
+namespace detail {
+
+inline void prefetch_bytes(const void *addr, size_t bytes) {
+  auto p = static_cast<const char*>(addr);
+  for (size_t off{0}; off < bytes; off += cache_line_size)
+    HEAPFREE_PREFETCH(p + off);
+}
+
+} // namespace detail
+
+/// Call fn for each segment in the chain, while prefetching the next
+/// segment.
+///
+/// Traversing a chain is pointer chasing: Each segment can only be loaded
+/// once the previous one is. This issues the load for the next segment
+/// before fn runs, so it overlaps with the work done by fn. `bytes` is the
+/// number of bytes prefetched per segment; pass more than the segment size
+/// if fn accesses memory stored right after the segment (as event
+/// listeners do).
+///
+/// Only the next segment is prefetched: Finding segments further ahead
+/// means waiting for the ones in between, so a linked list gains nothing
+/// from a larger distance. The step to the next segment is taken after fn
+/// returns, so fn may unlink any segment except the one it is called with,
+/// just like in a regular loop over segments().
+template<typename Chain, typename Fn>
+void for_each_segment_prefetch(Chain &ch, Fn &&fn,
+    size_t bytes = sizeof(typename Chain::segment)) {
+  auto r = ch.lean_segments();
+  const auto end = r.end();
+  for (auto it = r.begin(); it != end; ++it) {
+    if (auto nx = std::next(it); nx != end)
+      detail::prefetch_bytes(&*nx, bytes);
+    fn(*it);
+  }
+}
+
+/// Like for_each_segment_prefetch(), but fn is called with the values
+template<typename Chain, typename Fn>
+void for_each_prefetch(Chain &ch, Fn &&fn,
+    size_t bytes = sizeof(typename Chain::segment)) {
+  for_each_segment_prefetch(ch, [&fn](auto &seg) { fn(seg.value()); }, bytes);
+}
+
 } // namespace heapfree
 } // namespace hardwave
@@ -0,0 +1,479 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/iterator_range.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+namespace detail {
+
+template<typename, bool, bool>
+class compact_chain_iterator;
+
+/// Links used by compact chains.
+///
+/// Instead of pointers, the links store the distance in bytes from
+/// this node to the next/previous node. An offset of zero refers to the
+/// node itself; this is used to mark unlinked segments and empty chains.
+template<typename Offset>
+struct compact_chain_ptr {
+  static_assert(std::is_integral_v<Offset> && std::is_signed_v<Offset>,
+      "Compact chain offsets must be signed integers");
+
+  using me_t = compact_chain_ptr<Offset>;
+
+  Offset next_off{0}, prev_off{0};
+
+  me_t& ptrs() { return *this; }
+  const me_t& ptrs() const { return *this; }
+
+  me_t* at(Offset off) const {
+    return reinterpret_cast<me_t*>(reinterpret_cast<std::uintptr_t>(this) + off);
+  }
+
+  Offset offset_to(const me_t *p) const {
+    auto d = static_cast<std::intptr_t>(reinterpret_cast<std::uintptr_t>(p)
+      - reinterpret_cast<std::uintptr_t>(this));
+    HEAPFREE_ASSERT(d >= std::numeric_limits<Offset>::min()
+        && d <= std::numeric_limits<Offset>::max(),
+        "Compact chain nodes are too far apart for the offset type");
+    return static_cast<Offset>(d);
+  }
+
+  me_t* next() const { return at(next_off); }
+  me_t* prev() const { return at(prev_off); }
+
+  /// Make this node the one between p and n.
+  ///
+  /// All offsets are calculated before any of them is written, so if one
+  /// of them is out of range, the chain is left as it was. (The offset
+  /// from a to b may be out of range even if the one from b to a is not.)
+  void link_between(me_t *p, me_t *n) {
+    const Offset to_prev{offset_to(p)}, to_next{offset_to(n)},
+      from_prev{p->offset_to(this)}, from_next{n->offset_to(this)};
+    prev_off = to_prev;
+    next_off = to_next;
+    p->next_off = from_prev;
+    n->prev_off = from_next;
+  }
+
+  /// Remove this node, linking its neighbours to each other; like
+  /// link_between(), this does nothing if their offsets are out of range.
+  void unlink_node() {
+    auto *n = next(), *p = prev();
+    const Offset n_to_p{n->offset_to(p)}, p_to_n{p->offset_to(n)};
+    n->prev_off = n_to_p;
+    p->next_off = p_to_n;
+    next_off = prev_off = 0;
+  }
+
+  /// Take over the position of `otr` in its chain;
+  /// the offsets are recalculated relative to this node.
+  void take_links(me_t &otr) {
+    if (otr.next_off == 0) return;
+    link_between(otr.prev(), otr.next());
+    otr.next_off = otr.prev_off = 0;
+  }
+};
+
+/// This type stores the actual data contained in compact chains.
+/// Works just like chain_segment, but the links are stored as offsets.
+///
+/// Compact chain segments are unlinked from their chain, when they go out of scope.
+/// Segments may be moved; the links of neighbouring segments are updated,
+/// just like with chain_segment.
+template<typename Chain>
+class compact_chain_segment : private compact_chain_ptr<typename Chain::offset_type> {
+  using me_alias = compact_chain_segment<Chain>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, compact_chain_ptr<typename Chain::offset_type>)
+
+  typename Chain::value_type payload;
+
+public:
+  using chain_type = Chain;
+
+  template<typename, bool, bool>
+  friend class detail::compact_chain_iterator;
+  friend chain_type;
+
+  compact_chain_segment() = default;
+
+  compact_chain_segment(const me_t&) = delete;
+  compact_chain_segment& operator=(const me_t&) = delete;
+
+  /// Compact chain segments can be move constructed.
+  /// In this case the payload AND the links are moved,
+  /// the source segment is UNLINKED.
+  compact_chain_segment(me_t &&otr) : payload{std::move(otr.payload)} {
+    super().take_links(otr.super());
+  }
+  compact_chain_segment& operator=(me_t &&otr) {
+    if (is_linked())
+      unlink();
+    payload = std::move(otr.payload);
+    super().take_links(otr.super());
+    return me();
+  }
+
+  compact_chain_segment(typename Chain::const_reference v) : payload{v} {}
+  typename Chain::reference operator=(typename Chain::const_reference v) {
+    payload = v;
+    return payload;
+  }
+
+  compact_chain_segment(typename Chain::value_type &&v) : payload{std::move(v)} {}
+  typename Chain::reference operator=(typename Chain::value_type &&v) {
+    payload = std::move(v);
+    return payload;
+  }
+
+  template<typename... Args>
+  compact_chain_segment(std::in_place_t, Args&&... args)
+    : payload{std::forward<Args>(args)...} {}
+
+  ~compact_chain_segment() {
+    if (is_linked())
+      unlink();
+  }
+
+  /// Swapping swaps both the payload AND the links
+  void swap(me_t &otr) {
+    me_t tmp{std::move(otr)};
+    otr = std::move(me());
+    me() = std::move(tmp);
+  }
+
+  /// Return the value stored in this segment
+  typename Chain::reference value() { return payload; }
+  typename Chain::const_reference value() const { return payload; }
+
+  typename Chain::reference operator*() { return payload; }
+  typename Chain::const_reference operator*() const { return payload; }
+
+  typename Chain::pointer operator->() { return &payload; }
+  typename Chain::const_pointer operator->() const { return &payload; }
+
+  /// Check if this segment is part of some chain
+  bool is_linked() const {
+    return super().next_off != 0;
+  }
+
+  void unlink() {
+    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a segment that is not linked.");
+    super().unlink_node();
+  }
+};
+
+/// Iterator over compact chains.
+/// Returned by begin()/end() and segments().begin()/end()
+/// This is a bidirectional iterator.
+///
+/// Validity rules are the same as for chain_iterator.
+template<typename Chain, bool Const, bool Segments = false>
+class compact_chain_iterator {
+  using me_alias = compact_chain_iterator<Chain, Const, Segments>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool, bool>
+  friend class detail::compact_chain_iterator;
+  friend Chain;
+
+  using chain_t = std::conditional_t<Const, const Chain, Chain>;
+  using seg_t = std::conditional_t<Const, const typename chain_t::segment, typename chain_t::segment>;
+  using ptr_t = compact_chain_ptr<typename Chain::offset_type>;
+
+  const ptr_t *ch{nullptr};
+  ptr_t *pt{nullptr};
+
+  compact_chain_iterator(const ptr_t &c, const ptr_t &p)
+    : ch{&c}, pt{const_cast<ptr_t*>(&p)} {}
+
+  void assert_nonull(std::string_view activity) const {
+    HEAPFREE_ASSERT(pt != nullptr && ch != nullptr,
+        "Cannot ", activity, " a null chain operator");
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = std::conditional_t<Segments,
+    typename chain_t::segment, typename chain_t::value_type>;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  compact_chain_iterator() = default;
+
+  template<bool Const2>
+  compact_chain_iterator(const compact_chain_iterator<Chain, Const2, Segments> &otr)
+      : ch{otr.ch}, pt{otr.pt} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  bool is_end() const {
+    assert_nonull("call is_end()");
+    return ch == pt;
+  }
+
+  /// Return the segment this iterator points to, even if the iterator is
+  /// a chain-value iterator
+  seg_t& segment() const {
+    HEAPFREE_ASSERT(!is_end(), "Cannot dereference chain iterator: its at the end");
+    return static_cast<seg_t&>(*pt);
+  }
+
+  /// Return the value this iterator points to, even if the iterator is
+  /// a chain-segment iterator
+  std::conditional_t<Const, typename Chain::const_reference, typename Chain::reference>
+  value() const {
+    return segment().value();
+  }
+
+  reference operator*() const {
+    if constexpr (Segments)
+      return segment();
+    else
+      return value();
+  }
+
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator--() {
+    assert_nonull("decrement");
+    pt = pt->prev();
+    HEAPFREE_ASSERT(!is_end(), "Can not decrement begin() iterator.");
+    return me();
+  }
+  me_t& operator++() {
+    HEAPFREE_ASSERT(!is_end(), "Can not increment end() iterator.");
+    pt = pt->next();
+    return me();
+  }
+
+  me_t operator--(int) {
+    me_t r{me()};
+    --me();
+    return r;
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const compact_chain_iterator<Chain, Const2, Segments> &otr) const {
+    return otr.ch == ch && otr.pt == pt;
+  }
+
+  template<typename T>
+  bool operator!=(const T &otr) const {
+    return !(me() == otr);
+  }
+};
+
+} // namespace detail
+
+/// A chain whose links are stored as relative offsets instead of pointers.
+///
+/// On 64 bit platforms, the two pointers per segment of a chain often take
+/// up more space than the payload. A compact chain stores the distance
+/// between the segments instead, as an integer of type `Offset` (32 bit by
+/// default); with 32 bit offsets this saves 8 bytes per segment.
+///
+/// The catch is that the chain and all of its segments must be stored within
+/// range of the offset type of each other, e.g. within ±2GiB for 32 bit offsets.
+/// Linking a segment that is too far away aborts through HEAPFREE_ASSERT.
+/// Note that on typical 64 bit systems, the stack and statically allocated
+/// memory are further apart than that, so chains and segments should be
+/// allocated in the same area.
+///
+/// Apart from this, compact chains work just like chains: segments are
+/// allocated by the user, unlink themselves when they go out of scope and
+/// may be moved freely.
+///
+/// ```c++
+/// compact_chain<int> my_chain;            // 32 bit offsets
+/// compact_chain<int, int16_t> tiny_chain; // 16 bit offsets
+///
+/// auto a = my_chain.place_back(42);
+/// ```
+template<typename T, typename Offset = std::int32_t>
+class compact_chain : private detail::compact_chain_ptr<Offset> {
+  using me_alias = compact_chain<T, Offset>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, detail::compact_chain_ptr<Offset>)
+  using ptr_t = detail::compact_chain_ptr<Offset>;
+
+public:
+  using value_type      = T;
+  using offset_type     = Offset;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::compact_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::compact_chain_iterator<me_t, true>;
+
+  /// The segment type is allocated by the user and stores the actual data
+  /// See detail::compact_chain_segment
+  using segment = detail::compact_chain_segment<me_t>;
+
+  template<typename, bool, bool>
+  friend class detail::compact_chain_iterator;
+  friend segment;
+
+  /// At the start a chain is empty
+  compact_chain() = default;
+
+  ~compact_chain() {
+    clear();
+  }
+
+  compact_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  compact_chain(me_t &&otr) {
+    super().take_links(otr.super());
+  }
+
+  me_t& operator=(me_t &&otr) {
+    clear();
+    super().take_links(otr.super());
+    return me();
+  }
+
+  void swap(me_t &otr) {
+    me_t tmp{std::move(otr)};
+    otr = std::move(me());
+    me() = std::move(tmp);
+  }
+
+  // Size is O(N)
+  size_t size() const { return std::distance(begin(), end()); }
+  bool empty() const { return super().next_off == 0; }
+
+  /// This can be used to link an existing segment into the chain.
+  /// The segment must not be linked for this
+  iterator link(const_iterator it, segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "");
+    HEAPFREE_ASSERT(it.ch == &super(), "");
+    ptr_t &sis = seg.ptrs();
+    ptr_t *n = it.pt;
+    sis.link_between(n->prev(), n);
+    return {super(), sis};
+  }
+
+  iterator link_back(segment &seg) {
+    return link(end(), seg);
+  }
+
+  iterator link_front(segment &seg) {
+    return link(begin(), seg);
+  }
+
+  /// Unlinks a single segment from the chain;
+  /// returns an iterator just after the one that was removed.
+  iterator unlink(iterator it) {
+    HEAPFREE_ASSERT(it.ch == &super(), "");
+    auto r = std::next(it);
+    it.segment().unlink();
+    return r;
+  }
+
+  /// Unlinks *all* segments from the list
+  void clear() {
+    ptr_t *cur{super().next()}, *nx;
+    while (cur != &super()) {
+      nx = cur->next();
+      cur->next_off = cur->prev_off = 0;
+      cur = nx;
+    }
+    super().next_off = super().prev_off = 0; // Make us self referential
+  }
+
+  /// Construct and link a segment in one go.
+  /// The parameters are forwarded to the segment constructor.
+  template<typename... Args>
+  [[nodiscard]] segment place(const_iterator it, Args&&... args) {
+    segment seg{std::forward<Args>(args)...};
+    link(it, seg);
+    return seg;
+  }
+
+  template<typename... Args>
+  [[nodiscard]] segment place_front(Args&&... args) {
+    return place(begin(), std::forward<Args>(args)...);
+  }
+
+  template<typename... Args>
+  [[nodiscard]] segment place_back(Args&&... args) {
+    return place(end(), std::forward<Args>(args)...);
+  }
+
+  iterator begin() { return {super(), *super().next()}; }
+  iterator end() { return {super(), super()}; }
+
+  const_iterator begin() const { return {super(), *super().next()}; }
+  const_iterator end() const { return {super(), super()}; }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *std::prev(end()); }
+  const_reference back() const { return *std::prev(end()); }
+
+  /// This is a linked list, so numeric access is O(N)
+  reference operator[](size_type idx) {
+    return iterator_range{me()}[idx];
+  }
+  const_reference operator[](size_type idx) const {
+    return const_cast<me_t&>(*this)[idx];
+  }
+
+  /// Constructs an iterator_range, that can be used to iterate over all
+  /// segments in the chain, instead of the values
+  auto segments() {
+    using It = detail::compact_chain_iterator<me_t, false, true>;
+    return iterator_range{It{super(), *super().next()}, It{super(), super()}};
+  }
+  auto segments() const {
+    using It = detail::compact_chain_iterator<me_t, true, true>;
+    return iterator_range{It{super(), *super().next()}, It{super(), super()}};
+  }
+};
+
+/// A position independent chain for memory shared between processes.
+///
+/// Since compact chains only store offsets between the nodes, a compact
+/// chain that is stored together with all of its segments in one memory
+/// region stays valid, no matter at which address the region is mapped.
+/// E.g. a chain and its segments can be placed in a `shm_open()`/`mmap()`
+/// region; one process may link segments which another process, that
+/// mapped the region at a different address, then iterates over without
+/// copying them.
+///
+/// This is a compact chain with pointer sized offsets, so the region may
+/// be of any size; `compact_chain<T>` can be used for regions smaller
+/// than 2GiB to save space.
+///
+/// Keep in mind that
+///
+/// * the chain and its segments must be constructed inside the shared region
+///   (e.g. using placement new),
+/// * the payload must be position independent itself (no pointers),
+/// * iterators are only valid in the process that created them, and
+/// * chains do no synchronization: concurrent access from several processes
+///   needs to be protected by e.g. a process shared mutex.
+template<typename T>
+using shared_chain = compact_chain<T, std::ptrdiff_t>;
+
+} // namespace heapfree
+} // namespace hardwave
@@ -38,3 +38,11 @@ template<typename... Args>
 #define HEAPFREE_ASSERT(b, ...)        \
   if (!(b))                             \
     HEAPFREE_ABORT(__VA_ARGS__, " (", __FILE__, ":", __LINE__, ")");
+
+/// Like HEAPFREE_ASSERT, but the check is only compiled in if the
+/// constant expression `enabled` is true.
+/// This is used by data structures with a configurable check policy.
+#define HEAPFREE_ASSERT_IF(enabled, b, ...)  \
+  if constexpr (enabled) {                   \
+    HEAPFREE_ASSERT(b, __VA_ARGS__);         \
+  }
@@ -126,13 +126,20 @@ template<typename Lambda, typename... Args>
 
 /// Used to invoke all the event handlers of an event.
 /// Returns `true` if at least a single event listener was called.
+///
+/// The next listener is prefetched while the current one is called (see
+/// for_each_segment_prefetch()), including the cache line after the segment
+/// where the lambda context starts.
 template<typename... Args>
 bool try_fire(event<Args...> &ev, Args&&... args) {
-  for (auto &handler : ev.member_listeners.segments())
-    handler.value()((void*)&handler, std::forward<Args>(args)...);
-  for (auto &handler : ev.listeners.segments())
+  using segment = typename event<Args...>::chain_type::segment;
+  auto call = [&](segment &handler) {
     handler.value()((void*)&handler, std::forward<Args>(args)...);
-  return std::size(ev.listeners) > 0 || std::size(ev.member_listeners) > 0;
+  };
+  constexpr size_t prefetch_bytes = sizeof(segment) + cache_line_size;
+  for_each_segment_prefetch(ev.member_listeners, call, prefetch_bytes);
+  for_each_segment_prefetch(ev.listeners, call, prefetch_bytes);
+  return !std::empty(ev.listeners) || !std::empty(ev.member_listeners);
 }
 
 /// Used to invoke all the event handlers of an event.
@@ -0,0 +1,494 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/iterator_range.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+namespace detail {
+
+template<typename, bool, bool>
+class forward_chain_iterator;
+
+/// The single link stored in forward chain segments and headers.
+///
+/// The link of the last segment points back to the chain header; this
+/// link is tagged by setting the lowest bit, so the end of the chain can
+/// be detected without knowing the chain. A link of zero means the
+/// segment is not linked.
+struct forward_chain_ptr {
+  std::uintptr_t link{0};
+
+  static std::uintptr_t tag(forward_chain_ptr *p) {
+    return reinterpret_cast<std::uintptr_t>(p) | 1;
+  }
+
+  static std::uintptr_t untagged(forward_chain_ptr *p) {
+    return reinterpret_cast<std::uintptr_t>(p);
+  }
+
+  forward_chain_ptr& ptrs() { return *this; }
+  const forward_chain_ptr& ptrs() const { return *this; }
+
+  forward_chain_ptr* next() const {
+    return reinterpret_cast<forward_chain_ptr*>(link & ~std::uintptr_t{1});
+  }
+
+  /// Whether the link points to the chain header
+  bool is_last() const { return (link & 1) != 0; }
+
+  /// Find the node linking to this one by walking around the ring. O(N)
+  forward_chain_ptr& find_prev() {
+    forward_chain_ptr *p{this};
+    while (p->next() != this)
+      p = p->next();
+    return *p;
+  }
+};
+
+/// Chain header; in addition to the link to the first segment,
+/// this also stores the last segment, so appending is O(1).
+struct forward_chain_head : forward_chain_ptr {
+  forward_chain_ptr *tail{nullptr};
+
+  forward_chain_head() { reset(); }
+
+  void reset() {
+    link = tag(this);
+    tail = this;
+  }
+
+  bool empty() const { return is_last(); }
+};
+
+/// This type stores the actual data contained in forward chains.
+/// Works just like chain_segment, but it only contains a single link.
+///
+/// Forward chain segments are unlinked from their chain, when they go
+/// out of scope. Since the segment needs to find the segment before it
+/// in the chain for this, unlinking and moving linked segments is O(N).
+/// Unlinking the first segment through forward_chain::pop_front() is O(1).
+template<typename Chain>
+class forward_chain_segment : private forward_chain_ptr {
+  HEAPFREE_DECLARE_ME_SUPER(forward_chain_segment<Chain>, forward_chain_ptr)
+
+  typename Chain::value_type payload;
+
+  // Make the segment linking to otr link to us instead
+  void take_links(me_t &otr) {
+    if (!otr.is_linked()) return;
+    auto &p = otr.find_prev();
+    link = otr.link;
+    otr.link = 0;
+    p.link = untagged(&ptrs());
+    if (is_last())
+      static_cast<forward_chain_head*>(next())->tail = &ptrs();
+  }
+public:
+  using chain_type = Chain;
+
+  template<typename, bool, bool>
+  friend class detail::forward_chain_iterator;
+  friend chain_type;
+
+  forward_chain_segment() = default;
+
+  forward_chain_segment(const me_t&) = delete;
+  forward_chain_segment& operator=(const me_t&) = delete;
+
+  /// Forward chain segments can be move constructed.
+  /// In this case the payload AND the links are moved,
+  /// the source segment is UNLINKED. This is O(N) if the source
+  /// segment is linked.
+  forward_chain_segment(me_t &&otr) : payload{std::move(otr.payload)} {
+    take_links(otr);
+  }
+  forward_chain_segment& operator=(me_t &&otr) {
+    if (is_linked())
+      unlink();
+    payload = std::move(otr.payload);
+    take_links(otr);
+    return me();
+  }
+
+  forward_chain_segment(typename Chain::const_reference v) : payload{v} {}
+  typename Chain::reference operator=(typename Chain::const_reference v) {
+    payload = v;
+    return payload;
+  }
+
+  forward_chain_segment(typename Chain::value_type &&v) : payload{std::move(v)} {}
+  typename Chain::reference operator=(typename Chain::value_type &&v) {
+    payload = std::move(v);
+    return payload;
+  }
+
+  template<typename... Args>
+  forward_chain_segment(std::in_place_t, Args&&... args)
+    : payload{std::forward<Args>(args)...} {}
+
+  ~forward_chain_segment() {
+    if (is_linked())
+      unlink();
+  }
+
+  /// Swapping swaps both the payload AND the links
+  void swap(me_t &otr) {
+    me_t tmp{std::move(otr)};
+    otr = std::move(me());
+    me() = std::move(tmp);
+  }
+
+  /// Return the value stored in this segment
+  typename Chain::reference value() { return payload; }
+  typename Chain::const_reference value() const { return payload; }
+
+  typename Chain::reference operator*() { return payload; }
+  typename Chain::const_reference operator*() const { return payload; }
+
+  typename Chain::pointer operator->() { return &payload; }
+  typename Chain::const_pointer operator->() const { return &payload; }
+
+  /// Check if this segment is part of some chain
+  bool is_linked() const {
+    return link != 0;
+  }
+
+  /// Unlink this segment from its chain. O(N)
+  void unlink() {
+    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a segment that is not linked.");
+    auto &p = find_prev();
+    p.link = link;
+    if (is_last())
+      static_cast<forward_chain_head*>(next())->tail = &p;
+    link = 0;
+  }
+};
+
+/// Forward iterator over forward chains.
+/// Returned by begin()/end() and segments().begin()/end()
+///
+/// Consists of a single (tagged) link, the end iterator is the
+/// link to the chain header.
+template<typename Chain, bool Const, bool Segments = false>
+class forward_chain_iterator {
+  using me_alias = forward_chain_iterator<Chain, Const, Segments>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool, bool>
+  friend class detail::forward_chain_iterator;
+  friend Chain;
+
+  using chain_t = std::conditional_t<Const, const Chain, Chain>;
+  using seg_t = std::conditional_t<Const, const typename chain_t::segment, typename chain_t::segment>;
+
+  std::uintptr_t link{0};
+
+  explicit forward_chain_iterator(std::uintptr_t l) : link{l} {}
+
+  forward_chain_ptr* ptr() const {
+    return reinterpret_cast<forward_chain_ptr*>(link & ~std::uintptr_t{1});
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = std::conditional_t<Segments,
+    typename chain_t::segment, typename chain_t::value_type>;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::forward_iterator_tag;
+
+  forward_chain_iterator() = default;
+
+  template<bool Const2>
+  forward_chain_iterator(const forward_chain_iterator<Chain, Const2, Segments> &otr) : link{otr.link} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  bool is_end() const {
+    return (link & 1) != 0;
+  }
+
+  /// Return the segment this iterator points to, even if the iterator is
+  /// a chain-value iterator
+  seg_t& segment() const {
+    HEAPFREE_ASSERT(link != 0 && !is_end(),
+        "Cannot dereference forward chain iterator: its at the end or null");
+    return static_cast<seg_t&>(*ptr());
+  }
+
+  /// Return the value this iterator points to, even if the iterator is
+  /// a chain-segment iterator
+  std::conditional_t<Const, typename Chain::const_reference, typename Chain::reference>
+  value() const {
+    return segment().value();
+  }
+
+  reference operator*() const {
+    if constexpr (Segments)
+      return segment();
+    else
+      return value();
+  }
+
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator++() {
+    link = segment().link;
+    return me();
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const forward_chain_iterator<Chain, Const2, Segments> &otr) const {
+    return otr.link == link;
+  }
+
+  template<typename T>
+  bool operator!=(const T &otr) const {
+    return !(me() == otr);
+  }
+};
+
+} // namespace detail
+
+/// A singly linked version of chain.
+///
+/// Segments only contain a single link, saving one pointer per segment
+/// compared to chain. The chain header keeps track of the last segment,
+/// so link_back() is O(1), as is pop_front(); this makes forward chains
+/// well suited for queues.
+///
+/// Just like with chains, the user allocates the segments and links them
+/// into the chain. Segments are unlinked automatically when they go out
+/// of scope, but since there is no link to the previous segment, unlinking
+/// (and moving) a segment that is still linked is O(N).
+///
+/// # Example
+///
+/// ```c++
+/// #include <iostream>
+/// #include "hardwave/heapfree/forward_chain.hpp"
+///
+/// using namespace hardwave::heapfree;
+///
+/// int main() {
+///   forward_chain<int> queue;
+///
+///   auto a = queue.place_back(1);
+///   auto b = queue.place_back(2);
+///   auto c = queue.place_back(3);
+///
+///   while (!queue.empty())
+///     std::cerr << *queue.pop_front() << ", ";
+///   std::cerr << "\n";
+///
+///   return 0;
+/// }
+/// ```
+///
+/// Outputs:
+///
+/// ```
+/// 1, 2, 3,
+/// ```
+template<typename T>
+class forward_chain : private detail::forward_chain_head {
+  HEAPFREE_DECLARE_ME_SUPER(forward_chain<T>, detail::forward_chain_head)
+
+  void take_links(me_t &otr) {
+    if (otr.empty()) {
+      reset();
+      return;
+    }
+    link = otr.link;
+    tail = otr.tail;
+    tail->link = tag(this);
+    otr.reset();
+  }
+
+public:
+  using value_type      = T;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::forward_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::forward_chain_iterator<me_t, true>;
+
+  /// The segment type is allocated by the user and stores the actual data
+  /// See detail::forward_chain_segment
+  using segment = detail::forward_chain_segment<me_t>;
+
+  template<typename, bool, bool>
+  friend class detail::forward_chain_iterator;
+  friend segment;
+
+  /// At the start a chain is empty
+  forward_chain() = default;
+
+  ~forward_chain() {
+    clear();
+  }
+
+  forward_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  forward_chain(me_t &&otr) {
+    take_links(otr);
+  }
+
+  me_t& operator=(me_t &&otr) {
+    clear();
+    take_links(otr);
+    return me();
+  }
+
+  void swap(me_t &otr) {
+    me_t tmp{std::move(otr)};
+    otr = std::move(me());
+    me() = std::move(tmp);
+  }
+
+  // Size is O(N)
+  size_t size() const { return std::distance(begin(), end()); }
+  bool empty() const { return super().empty(); }
+
+  /// Link the segment just after the segment `it` points to.
+  /// The segment must not be linked for this
+  iterator link_after(const_iterator it, segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "");
+    HEAPFREE_ASSERT(!it.is_end(), "Can not link after the end of a forward chain");
+    auto &p = const_cast<detail::forward_chain_ptr&>(*it.ptr());
+    seg.link = p.link;
+    p.link = untagged(&seg.ptrs());
+    if (seg.is_last())
+      tail = &seg.ptrs();
+    return iterator{untagged(&seg.ptrs())};
+  }
+
+  /// Append a segment to the chain in O(1)
+  iterator link_back(segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "");
+    seg.link = tag(this);
+    tail->link = untagged(&seg.ptrs());
+    tail = &seg.ptrs();
+    return iterator{untagged(&seg.ptrs())};
+  }
+
+  iterator link_front(segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "");
+    seg.link = link;
+    link = untagged(&seg.ptrs());
+    if (seg.is_last())
+      tail = &seg.ptrs();
+    return iterator{link};
+  }
+
+  /// Unlink the first segment and return it in O(1)
+  segment& pop_front() {
+    HEAPFREE_ASSERT(!empty(), "Can not pop from an empty forward chain");
+    auto &seg = static_cast<segment&>(*next());
+    link = seg.link;
+    if (seg.is_last())
+      tail = this;
+    seg.link = 0;
+    return seg;
+  }
+
+  /// Unlinks the segment just after the one `it` points to in O(1);
+  /// returns an iterator just after the one that was removed.
+  iterator unlink_after(iterator it) {
+    auto &p = *it.ptr();
+    HEAPFREE_ASSERT(!it.is_end() && !p.is_last(),
+        "Can not unlink after the last segment of a forward chain");
+    auto &seg = static_cast<segment&>(*p.next());
+    p.link = seg.link;
+    if (seg.is_last())
+      tail = &p;
+    seg.link = 0;
+    return iterator{p.link};
+  }
+
+  /// Unlinks *all* segments from the chain
+  void clear() {
+    std::uintptr_t cur{link};
+    reset(); // Make us self referential
+    while (!(cur & 1)) {
+      auto *p = reinterpret_cast<detail::forward_chain_ptr*>(cur);
+      cur = p->link;
+      p->link = 0;
+    }
+  }
+
+  /// Construct and link a segment in one go.
+  /// The parameters are forwarded to the segment constructor.
+  template<typename... Args>
+  [[nodiscard]] segment place_front(Args&&... args) {
+    segment seg{std::forward<Args>(args)...};
+    link_front(seg);
+    return seg;
+  }
+
+  template<typename... Args>
+  [[nodiscard]] segment place_back(Args&&... args) {
+    segment seg{std::forward<Args>(args)...};
+    link_back(seg);
+    return seg;
+  }
+
+  iterator begin() { return iterator{link}; }
+  iterator end() { return iterator{tag(this)}; }
+
+  const_iterator begin() const { return const_iterator{link}; }
+  const_iterator end() const {
+    return const_iterator{tag(const_cast<me_t*>(this))};
+  }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+
+  /// Access to the last element is O(1)
+  reference back() {
+    HEAPFREE_ASSERT(!empty(), "Can not access the back of an empty forward chain");
+    return static_cast<segment&>(*tail).value();
+  }
+  const_reference back() const {
+    return const_cast<me_t&>(*this).back();
+  }
+
+  /// This is a linked list, so numeric access is O(N)
+  reference operator[](size_type idx) {
+    return iterator_range{me()}[idx];
+  }
+  const_reference operator[](size_type idx) const {
+    return const_cast<me_t&>(*this)[idx];
+  }
+
+  /// Constructs an iterator_range, that can be used to iterate over all
+  /// segments in the chain, instead of the values
+  auto segments() {
+    using It = detail::forward_chain_iterator<me_t, false, true>;
+    return iterator_range{It{link}, It{tag(this)}};
+  }
+  auto segments() const {
+    using It = detail::forward_chain_iterator<me_t, true, true>;
+    return iterator_range{It{link}, It{tag(const_cast<me_t*>(this))}};
+  }
+};
+
+} // namespace heapfree
+} // namespace hardwave
@@ -0,0 +1,559 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+template<typename, typename, typename, typename>
+class hash_chain;
+
+namespace detail {
+
+template<typename, bool>
+class hash_chain_iterator;
+
+struct hash_chain_node;
+
+/// Start of a singly linked list in a hash chain, along with the hash
+/// of the first node in that list; this is both the bucket type and
+/// the first member of each node, so unlinking never needs to know
+/// whether the predecessor is a bucket or a node.
+///
+/// Storing the hash next to the pointer lets lookups skip the key
+/// comparison for nodes whose hash does not match.
+struct hash_chain_link {
+  hash_chain_node *next{nullptr};
+  std::size_t next_hash{0};
+};
+
+/// Links of a node in a hash chain
+struct hash_chain_node : hash_chain_link {
+  hash_chain_link *pprev{nullptr}; // The link pointing to this node
+  std::size_t hash{0};
+
+  bool is_linked() const { return pprev != nullptr; }
+
+  /// Link this node at the start of the list
+  void link_after(hash_chain_link &l) {
+    next = l.next;
+    next_hash = l.next_hash;
+    if (next)
+      next->pprev = this;
+    pprev = &l;
+    l.next = this;
+    l.next_hash = hash;
+  }
+
+  void unlink() {
+    pprev->next = next;
+    pprev->next_hash = next_hash;
+    if (next)
+      next->pprev = pprev;
+    next = nullptr;
+    pprev = nullptr;
+  }
+
+  void take_links(hash_chain_node &otr) {
+    next = otr.next;
+    next_hash = otr.next_hash;
+    pprev = otr.pprev;
+    hash = otr.hash;
+    pprev->next = this;
+    if (next)
+      next->pprev = this;
+    otr.next = nullptr;
+    otr.pprev = nullptr;
+  }
+};
+
+/// This type stores the actual data contained in hash chains: A key
+/// and a value, stored as std::pair<const K, V> just like
+/// std::unordered_map does.
+///
+/// Just like chain segments, they are allocated by the user, are
+/// unlinked when they go out of scope and may be moved. The key can not
+/// be changed; since std::pair<const K, V> is not assignable, segments
+/// can be move constructed but not move assigned.
+template<typename Chain>
+class hash_chain_segment : private hash_chain_node {
+  HEAPFREE_DECLARE_ME_SUPER(hash_chain_segment<Chain>, hash_chain_node)
+
+  friend Chain;
+  template<typename, bool>
+  friend class detail::hash_chain_iterator;
+
+  typename Chain::value_type payload;
+
+public:
+  using chain_type = Chain;
+  using key_type = typename Chain::key_type;
+  using mapped_type = typename Chain::mapped_type;
+
+  hash_chain_segment() = default;
+
+  hash_chain_segment(const key_type &k) : payload{k, mapped_type{}} {}
+
+  template<typename M>
+  hash_chain_segment(const key_type &k, M &&v) : payload{k, std::forward<M>(v)} {}
+
+  template<typename... Args>
+  hash_chain_segment(std::in_place_t, Args&&... args)
+    : payload{std::forward<Args>(args)...} {}
+
+  // Copying links is never what you want
+  hash_chain_segment(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  /// Moving moves the payload AND the links; the source segment is unlinked
+  hash_chain_segment(me_t &&otr) : payload{std::move(otr.payload)} {
+    if (otr.is_linked())
+      super().take_links(otr.super());
+  }
+  me_t& operator=(me_t &&otr) = delete;
+
+  ~hash_chain_segment() {
+    if (is_linked())
+      unlink();
+  }
+
+  const key_type& key() const { return payload.first; }
+
+  mapped_type& value() { return payload.second; }
+  const mapped_type& value() const { return payload.second; }
+
+  typename Chain::reference operator*() { return payload; }
+  typename Chain::const_reference operator*() const { return payload; }
+
+  typename Chain::pointer operator->() { return &payload; }
+  typename Chain::const_pointer operator->() const { return &payload; }
+
+  /// Check if this segment is part of some chain
+  bool is_linked() const { return super().is_linked(); }
+
+  /// Unlink the segment from its chain; O(1)
+  void unlink() {
+    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a segment that is not linked.");
+    super().unlink();
+  }
+};
+
+/// Forward iterator over all segments in a hash chain, in no particular
+/// order. Iterators are invalidated by rehashing; insert() performs
+/// rehash steps while a rehash is in progress.
+template<typename Chain, bool Const>
+class hash_chain_iterator {
+  using me_alias = hash_chain_iterator<Chain, Const>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool>
+  friend class detail::hash_chain_iterator;
+  friend Chain;
+
+  using seg_t = std::conditional_t<Const, const typename Chain::segment, typename Chain::segment>;
+
+  const Chain *ch{nullptr};
+  const hash_chain_link *b{nullptr};
+  hash_chain_node *pt{nullptr};
+
+  hash_chain_iterator(const Chain &c, const hash_chain_link *bucket, hash_chain_node *n)
+    : ch{&c}, b{bucket}, pt{n} {
+    settle();
+  }
+
+  /// Move on to the next non empty bucket if we are at the end of one
+  void settle() {
+    while (!pt && b) {
+      b = ch->next_bucket(b);
+      pt = b ? b->next : nullptr;
+    }
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = typename Chain::value_type;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::forward_iterator_tag;
+
+  hash_chain_iterator() = default;
+
+  template<bool Const2>
+  hash_chain_iterator(const hash_chain_iterator<Chain, Const2> &otr)
+    : ch{otr.ch}, b{otr.b}, pt{otr.pt} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  /// Return the segment this iterator points to
+  seg_t& segment() const {
+    HEAPFREE_ASSERT(pt != nullptr, "Cannot dereference chain iterator: its at the end");
+    return static_cast<seg_t&>(*pt);
+  }
+
+  reference operator*() const { return *segment(); }
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator++() {
+    HEAPFREE_ASSERT(pt != nullptr, "Cannot increment chain iterator: its at the end");
+    pt = pt->next;
+    settle();
+    return me();
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const hash_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt == pt;
+  }
+
+  template<bool Const2>
+  bool operator!=(const hash_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt != pt;
+  }
+};
+
+} // namespace detail
+
+/// An unordered multimap built from user allocated segments and a user
+/// allocated bucket array.
+///
+/// Each bucket is a singly linked list of segments; segments also point
+/// back to their predecessor, so they can unlink themselves in O(1)
+/// (also when they go out of scope). Each bucket and each segment store
+/// the hash of the following segment next to the pointer to it, so
+/// lookups only compare (and load) the keys of segments whose hash
+/// matches. Buckets are 16 bytes, so four of them share a cache line.
+///
+/// The number of buckets must be a power of two. The table never grows
+/// by itself: Call `rehash()` with a second, larger bucket array to start
+/// moving the segments over. This is done incrementally: Each insert
+/// moves a single bucket, and `rehash_step()` can be used to move more;
+/// lookups check both arrays until the rehash is done. Afterwards the
+/// old bucket array is no longer used.
+///
+/// Several segments may have equal keys; find() returns the one inserted
+/// last.
+///
+/// # Example
+///
+/// ```c++
+/// using conn_map = hash_chain<int, connection>;
+/// conn_map::bucket buckets[64];
+/// conn_map conns{buckets};
+///
+/// conn_map::segment a{4, connection{...}}, b{9, connection{...}};
+/// conns.insert(a);
+/// conns.insert(b);
+/// conns.find(9)->second; // b's connection
+///
+/// // Grow the table
+/// static conn_map::bucket more[1024];
+/// conns.rehash(more);
+/// ```
+template<typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class hash_chain {
+  using me_alias = hash_chain<K, V, Hash, KeyEqual>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+public:
+  using key_type        = K;
+  using mapped_type     = V;
+  using hasher          = Hash;
+  using key_equal       = KeyEqual;
+  using value_type      = std::pair<const K, V>;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::hash_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::hash_chain_iterator<me_t, true>;
+
+  /// The segment type is allocated by the user and stores the actual data
+  /// See detail::hash_chain_segment
+  using segment = detail::hash_chain_segment<me_t>;
+
+  /// The bucket type; arrays of buckets are provided by the user
+  using bucket = detail::hash_chain_link;
+
+private:
+  template<typename, bool>
+  friend class detail::hash_chain_iterator;
+
+  using node = detail::hash_chain_node;
+
+  Hash hash_fn;
+  KeyEqual eq;
+  bucket *table{nullptr};
+  size_t mask{0};
+  bucket *old{nullptr}; // Bucket array being migrated away from
+  size_t old_mask{0};
+  size_t progress{0};   // Buckets in old below this have been migrated
+
+  static size_t checked_mask(size_t count) {
+    HEAPFREE_ASSERT(count > 0 && (count & (count - 1)) == 0,
+        "The number of buckets in a hash chain must be a power of two; got ", count);
+    return count - 1;
+  }
+
+  static void clear_buckets(bucket *b, size_t count) {
+    for (size_t i{0}; i < count; i++)
+      b[i] = bucket{};
+  }
+
+  static node* search(const bucket &b, size_t h, const K &k, const KeyEqual &eq) {
+    for (const detail::hash_chain_link *l{&b}; l->next; l = l->next) {
+      if (l->next_hash == h && eq(static_cast<const segment*>(l->next)->key(), k))
+        return l->next;
+    }
+    return nullptr;
+  }
+
+  node* find_node(const K &k) const {
+    const size_t h{hash_fn(k)};
+    if (node *n = search(table[h & mask], h, k, eq))
+      return n;
+    if (old && (h & old_mask) >= progress)
+      return search(old[h & old_mask], h, k, eq);
+    return nullptr;
+  }
+
+  /// Used by the iterator: Bucket following b, covering the current
+  /// table followed by the part of the old table not migrated yet.
+  const bucket* next_bucket(const bucket *b) const {
+    if (b >= table && b <= table + mask) {
+      if (b < table + mask)
+        return b + 1;
+      return old && progress <= old_mask ? old + progress : nullptr;
+    }
+    return b < old + old_mask ? b + 1 : nullptr;
+  }
+
+  /// The bucket the given node is in; O(1) on average
+  const bucket* bucket_of(const node *n) const {
+    auto in = [](const bucket *b, const bucket *arr, size_t m) {
+      return arr && b >= arr && b <= arr + m;
+    };
+    const detail::hash_chain_link *l{n->pprev};
+    while (!in(l, table, mask) && !in(l, old, old_mask))
+      l = static_cast<const node*>(l)->pprev;
+    return l;
+  }
+
+  static void unlink_all(bucket *b, size_t count) {
+    for (size_t i{0}; i < count; i++)
+      while (b[i].next)
+        b[i].next->unlink();
+  }
+
+public:
+  /// Construct a hash chain using the given buckets; the number of
+  /// buckets must be a power of two. The buckets must outlive the chain
+  /// (or the rehash moving segments out of them).
+  hash_chain(bucket *buckets, size_t count, const Hash &h = Hash{}, const KeyEqual &e = KeyEqual{})
+    : hash_fn{h}, eq{e}, table{buckets}, mask{checked_mask(count)} {
+    clear_buckets(table, count);
+  }
+
+  template<size_t N>
+  hash_chain(bucket (&buckets)[N], const Hash &h = Hash{}, const KeyEqual &e = KeyEqual{})
+    : hash_chain{buckets, N, h, e} {}
+
+  ~hash_chain() {
+    clear();
+  }
+
+  hash_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  /// The segments stay linked to the bucket arrays, which are taken over
+  /// by the new chain; the old one becomes unusable.
+  hash_chain(me_t &&otr)
+    : hash_fn{otr.hash_fn}, eq{otr.eq}, table{otr.table}, mask{otr.mask},
+      old{otr.old}, old_mask{otr.old_mask}, progress{otr.progress} {
+    otr.table = otr.old = nullptr;
+    otr.mask = otr.old_mask = otr.progress = 0;
+  }
+
+  /// Unlinks the segments of this chain and takes over the bucket
+  /// arrays of the other one, which becomes unusable.
+  me_t& operator=(me_t &&otr) {
+    if (&otr == this)
+      return me();
+    clear();
+    hash_fn = otr.hash_fn;
+    eq = otr.eq;
+    table = otr.table;
+    mask = otr.mask;
+    old = otr.old;
+    old_mask = otr.old_mask;
+    progress = otr.progress;
+    otr.table = otr.old = nullptr;
+    otr.mask = otr.old_mask = otr.progress = 0;
+    return me();
+  }
+
+  /// Exchanges the bucket arrays (and with them the segments); O(1)
+  void swap(me_t &otr) {
+    using std::swap;
+    swap(hash_fn, otr.hash_fn);
+    swap(eq, otr.eq);
+    swap(table, otr.table);
+    swap(mask, otr.mask);
+    swap(old, otr.old);
+    swap(old_mask, otr.old_mask);
+    swap(progress, otr.progress);
+  }
+
+  /// Size is O(N + number of buckets)
+  size_t size() const { return std::distance(begin(), end()); }
+  bool empty() const { return begin() == end(); }
+
+  size_t bucket_count() const { return mask + 1; }
+
+  hasher hash_function() const { return hash_fn; }
+  key_equal key_eq() const { return eq; }
+
+  /// Insert the segment; O(1). Moves one bucket if a rehash is in progress.
+  iterator insert(segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "Cannot insert a segment that is already linked.");
+    rehash_step();
+    node &n = seg.super();
+    n.hash = hash_fn(seg.key());
+    bucket &b = table[n.hash & mask];
+    n.link_after(b);
+    return iterator{me(), &b, &n};
+  }
+
+  /// Unlinks a single segment from the chain; O(1).
+  /// Returns an iterator just after the one that was removed.
+  iterator erase(iterator it) {
+    auto r = std::next(it);
+    it.segment().unlink();
+    return r;
+  }
+
+  /// Unlinks all segments with the given key;
+  /// returns the number of segments removed.
+  size_t erase(const K &k) {
+    size_t r{0};
+    for (node *n; (n = find_node(k)); r++)
+      n->unlink();
+    return r;
+  }
+
+  /// Unlinks *all* segments from the chain; O(N + number of buckets)
+  void clear() {
+    if (!table)
+      return;
+    unlink_all(table, mask + 1);
+    if (old)
+      unlink_all(old + progress, old_mask + 1 - progress);
+    old = nullptr;
+  }
+
+  /// Segment with the given key or end(); O(1) on average
+  iterator find(const K &k) {
+    node *n{find_node(k)};
+    return n ? iterator{me(), bucket_of(n), n} : end();
+  }
+  const_iterator find(const K &k) const {
+    return const_cast<me_t&>(me()).find(k);
+  }
+
+  bool contains(const K &k) const { return find_node(k) != nullptr; }
+
+  /// Number of segments with the given key
+  size_t count(const K &k) const {
+    const size_t h{hash_fn(k)};
+    size_t r{0};
+    auto count_in = [&](const bucket &b) {
+      for (const detail::hash_chain_link *l{&b}; l->next; l = l->next)
+        if (l->next_hash == h && eq(static_cast<const segment*>(l->next)->key(), k))
+          r++;
+    };
+    count_in(table[h & mask]);
+    if (old && (h & old_mask) >= progress)
+      count_in(old[h & old_mask]);
+    return r;
+  }
+
+  /// Start moving all segments into the given buckets; the number of
+  /// buckets must be a power of two. The segments are moved
+  /// incrementally by insert() and rehash_step(), so the current
+  /// buckets must stay alive until rehashing() returns false.
+  /// A rehash that is still in progress is finished first.
+  void rehash(bucket *buckets, size_t count) {
+    const size_t m{checked_mask(count)};
+    HEAPFREE_ASSERT(buckets != table, "Cannot rehash a hash chain into the buckets it already uses.");
+    finish_rehash();
+    clear_buckets(buckets, count);
+    old = table;
+    old_mask = mask;
+    progress = 0;
+    table = buckets;
+    mask = m;
+  }
+
+  template<size_t N>
+  void rehash(bucket (&buckets)[N]) {
+    rehash(buckets, N);
+  }
+
+  bool rehashing() const { return old != nullptr; }
+
+  /// Move up to the given number of buckets from the old bucket array;
+  /// returns true if there is still more work to do.
+  bool rehash_step(size_t buckets = 1) {
+    for (; old && buckets > 0; buckets--) {
+      // Segments already in the new buckets were inserted after the
+      // rehash started, so the moved ones go behind them, in their
+      // current order; this keeps the newest of equal keys in front.
+      // The tail is only searched when the destination changes, so runs
+      // of segments for the same bucket (e.g. equal keys) move in O(1)
+      // each.
+      bucket &b = old[progress];
+      bucket *dest{nullptr};
+      detail::hash_chain_link *tail{nullptr};
+      while (node *n = b.next) {
+        n->unlink();
+        if (bucket *d{&table[n->hash & mask]}; d != dest) {
+          dest = d;
+          for (tail = d; tail->next; tail = tail->next) {}
+        }
+        n->link_after(*tail);
+        tail = n;
+      }
+      if (++progress > old_mask) {
+        old = nullptr;
+        old_mask = progress = 0;
+      }
+    }
+    return rehashing();
+  }
+
+  void finish_rehash() {
+    rehash_step(old_mask + 1);
+  }
+
+  iterator begin() { return iterator{me(), table, table ? table->next : nullptr}; }
+  iterator end() { return iterator{}; }
+
+  const_iterator begin() const { return const_iterator{me(), table, table ? table->next : nullptr}; }
+  const_iterator end() const { return const_iterator{}; }
+};
+
+} // namespace heapfree
+} // namespace hardwave
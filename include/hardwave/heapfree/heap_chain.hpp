@@ -0,0 +1,371 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+template<typename, typename>
+class heap_chain;
+
+namespace detail {
+
+/// Links of a node in a pairing heap.
+///
+/// Children are a singly linked list starting at `child` and
+/// continuing with `next`; `prev` points to the left sibling or, for the
+/// first child, to the parent. The chain header is the parent of the
+/// root, so nodes can be removed without knowing which heap they are
+/// part of.
+struct heap_chain_node {
+  using me_t = heap_chain_node;
+
+  me_t *child{nullptr}, *next{nullptr}, *prev{nullptr};
+
+  bool is_linked() const { return prev != nullptr; }
+
+  /// The pointer in prev that points to this node
+  me_t*& slot() {
+    return prev->child == this ? prev->child : prev->next;
+  }
+
+  /// Put n where this node is in the tree (this node keeps its children)
+  void replace_with(me_t *n) {
+    slot() = n;
+    n->prev = prev;
+    n->next = next;
+    if (next)
+      next->prev = n;
+  }
+
+  /// Take over otr's position in the tree and its children
+  void take_links(me_t &otr) {
+    otr.replace_with(this);
+    child = otr.child;
+    if (child)
+      child->prev = this;
+    otr.child = otr.next = otr.prev = nullptr;
+  }
+};
+
+/// Segment of a heap chain; stores the value.
+///
+/// Just like chain segments, they are allocated by the user, are
+/// unlinked when they go out of scope and may be moved.
+template<typename Chain>
+class heap_chain_segment : private heap_chain_node {
+  HEAPFREE_DECLARE_ME_SUPER(heap_chain_segment<Chain>, heap_chain_node)
+
+  friend Chain;
+
+  typename Chain::value_type payload;
+
+public:
+  using chain_type = Chain;
+
+  heap_chain_segment() = default;
+
+  heap_chain_segment(typename Chain::const_reference v) : payload{v} {}
+  heap_chain_segment(typename Chain::value_type &&v) : payload{std::move(v)} {}
+
+  template<typename... Args>
+  heap_chain_segment(std::in_place_t, Args&&... args)
+    : payload{std::forward<Args>(args)...} {}
+
+  // Copying links is never what you want
+  heap_chain_segment(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  /// Moving moves the payload AND the links; the source segment is unlinked
+  heap_chain_segment(me_t &&otr) : payload{std::move(otr.payload)} {
+    if (otr.is_linked())
+      super().take_links(otr.super());
+  }
+  me_t& operator=(me_t &&otr) {
+    if (&otr == this)
+      return me();
+    if (is_linked())
+      unlink();
+    payload = std::move(otr.payload);
+    if (otr.is_linked())
+      super().take_links(otr.super());
+    return me();
+  }
+
+  ~heap_chain_segment() {
+    if (is_linked())
+      unlink();
+  }
+
+  /// The value; if it is changed while the segment is linked, call
+  /// heap_chain::update() to restore the heap order.
+  typename Chain::reference value() { return payload; }
+  typename Chain::const_reference value() const { return payload; }
+
+  typename Chain::reference operator*() { return payload; }
+  typename Chain::const_reference operator*() const { return payload; }
+
+  typename Chain::pointer operator->() { return &payload; }
+  typename Chain::const_pointer operator->() const { return &payload; }
+
+  /// Check if this segment is part of some heap
+  bool is_linked() const { return super().is_linked(); }
+
+  /// Remove the segment from its heap; O(log N) amortized
+  void unlink() {
+    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a segment that is not linked.");
+    Chain::unlink_node(super());
+  }
+};
+
+} // namespace detail
+
+/// A priority queue built from user allocated segments: An intrusive
+/// pairing heap.
+///
+/// Just like std::priority_queue, top() is the largest element according
+/// to Compare (use std::greater<> to get the smallest first). push() and
+/// meld() are O(1), pop() and unlinking arbitrary segments are O(log N)
+/// amortized. Segments unlink themselves when they go out of scope, so
+/// e.g. cancelled timers simply disappear instead of lingering in the
+/// queue as with lazy deletion.
+///
+/// Since segments must be able to unlink themselves without access to
+/// the heap, Compare is default constructed whenever it is needed; it
+/// must not have state.
+///
+/// # Example
+///
+/// ```c++
+/// heap_chain<int, std::greater<>> timers; // Earliest deadline first
+/// decltype(timers)::segment a{30}, b{10}, c{20};
+/// timers.push(a);
+/// timers.push(b);
+/// timers.push(c);
+///
+/// timers.top();   // 10
+/// b.unlink();     // Cancel
+/// timers.pop();   // Returns c
+/// ```
+template<typename T, typename Compare = std::less<T>>
+class heap_chain : private detail::heap_chain_node {
+  using me_alias = heap_chain<T, Compare>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, detail::heap_chain_node)
+
+  static_assert(std::is_default_constructible_v<Compare>,
+      "The comparator of a heap_chain must be default constructible.");
+
+public:
+  using value_type      = T;
+  using value_compare   = Compare;
+  using size_type       = size_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+
+  /// The segment type is allocated by the user and stores the actual data
+  /// See detail::heap_chain_segment
+  using segment = detail::heap_chain_segment<me_t>;
+
+private:
+  friend segment;
+
+  using node = detail::heap_chain_node;
+
+  node* root() const { return this->child; }
+
+  static const T& value_of(const node *n) {
+    return static_cast<const segment*>(n)->value();
+  }
+
+  /// Link two roots; the smaller one becomes the first child of the
+  /// larger one, which is returned. next and prev of the result are
+  /// left for the caller to set.
+  static node* meld_nodes(node *a, node *b) {
+    if (Compare{}(value_of(a), value_of(b)))
+      std::swap(a, b);
+    b->next = a->child;
+    if (b->next)
+      b->next->prev = b;
+    b->prev = a;
+    a->child = b;
+    return a;
+  }
+
+  /// Combine a list of siblings into a single tree: Meld them pairwise
+  /// from left to right, then meld the results from right to left.
+  static node* merge_pairs(node *first) {
+    if (!first)
+      return nullptr;
+    node *stack{nullptr};
+    while (first) {
+      node *a{first}, *b{a->next};
+      if (!b) {
+        a->next = stack;
+        stack = a;
+        break;
+      }
+      first = b->next;
+      node *m{meld_nodes(a, b)};
+      m->next = stack;
+      stack = m;
+    }
+    node *r{stack};
+    stack = stack->next;
+    while (stack) {
+      node *nx{stack->next};
+      r = meld_nodes(r, stack);
+      stack = nx;
+    }
+    return r;
+  }
+
+  /// Remove the node, replacing it with its merged children
+  static void unlink_node(node &n) {
+    if (node *sub = merge_pairs(n.child)) {
+      n.replace_with(sub);
+    } else {
+      n.slot() = n.next;
+      if (n.next)
+        n.next->prev = n.prev;
+    }
+    n.child = n.next = n.prev = nullptr;
+  }
+
+  void set_root(node *r) {
+    this->child = r;
+    if (r) {
+      r->prev = &super();
+      r->next = nullptr;
+    }
+  }
+
+public:
+  /// At the start a heap is empty
+  heap_chain() = default;
+
+  ~heap_chain() {
+    clear();
+  }
+
+  heap_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  heap_chain(me_t &&otr) {
+    me() = std::move(otr);
+  }
+
+  me_t& operator=(me_t &&otr) {
+    if (&otr == this)
+      return me();
+    clear();
+    set_root(otr.root());
+    otr.child = nullptr;
+    return me();
+  }
+
+  void swap(me_t &otr) {
+    node *r{root()};
+    set_root(otr.root());
+    otr.set_root(r);
+  }
+
+  bool empty() const { return root() == nullptr; }
+
+  /// Size is O(N)
+  size_t size() const {
+    size_t r{0};
+    // Walk the tree; going up is possible using prev, since prev of a
+    // first child is its parent
+    const node *n{root()};
+    while (n) {
+      r++;
+      if (n->child) {
+        n = n->child;
+        continue;
+      }
+      while (n && !n->next) {
+        // Find the parent: walk left to the first child
+        while (n->prev->child != n)
+          n = n->prev;
+        n = n->prev == &super() ? nullptr : n->prev;
+      }
+      if (n)
+        n = n->next;
+    }
+    return r;
+  }
+
+  /// Add a segment to the heap; O(1)
+  void push(segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "Cannot push a segment that is already linked.");
+    node *n{&seg.super()};
+    n->child = nullptr;
+    set_root(root() ? meld_nodes(root(), n) : n);
+  }
+
+  /// The largest value in the heap; O(1)
+  reference top() {
+    HEAPFREE_ASSERT(!empty(), "Cannot get the top of an empty heap_chain.");
+    return static_cast<segment*>(root())->value();
+  }
+  const_reference top() const {
+    return const_cast<me_t&>(me()).top();
+  }
+
+  /// The segment holding the largest value; O(1)
+  segment& top_segment() {
+    HEAPFREE_ASSERT(!empty(), "Cannot get the top of an empty heap_chain.");
+    return *static_cast<segment*>(root());
+  }
+
+  /// Remove the largest segment and return it; O(log N) amortized
+  segment& pop() {
+    segment &r{top_segment()};
+    unlink_node(*root());
+    return r;
+  }
+
+  /// Restore the heap order after the value of the segment changed;
+  /// O(log N) amortized
+  void update(segment &seg) {
+    HEAPFREE_ASSERT(seg.is_linked(), "Cannot update a segment that is not linked.");
+    unlink_node(seg.super());
+    push(seg);
+  }
+
+  /// Move all segments from otr into this heap; O(1)
+  void meld(me_t &otr) {
+    HEAPFREE_ASSERT(&otr != this, "Cannot meld a heap_chain with itself.");
+    if (otr.empty())
+      return;
+    set_root(root() ? meld_nodes(root(), otr.root()) : otr.root());
+    otr.child = nullptr;
+  }
+
+  /// Unlinks *all* segments from the heap; O(N)
+  void clear() {
+    // Remove first children that are leaves until the tree is gone
+    node *n{root()};
+    while (n) {
+      if (n->child) {
+        n = n->child;
+        continue;
+      }
+      node *p{n->prev};
+      p->child = n->next;
+      if (n->next)
+        n->next->prev = p;
+      n->next = n->prev = nullptr;
+      n = p == &super() ? root() : p;
+    }
+  }
+};
+
+} // namespace heapfree
+} // namespace hardwave
@@ -0,0 +1,201 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/chain.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+template<typename... Types>
+class hetero_chain;
+
+namespace detail {
+
+/// Position of T in Types...; sizeof...(Types) if T is not part of Types
+template<typename T, typename... Types>
+constexpr size_t hetero_type_index() {
+  constexpr bool matches[] = {std::is_same_v<T, Types>..., true};
+  size_t r{0};
+  while (!matches[r])
+    r++;
+  return r;
+}
+
+/// Segment of a hetero_chain storing a value of type T.
+/// The underlying chain segment stores the index of T in the list of
+/// types of the chain, which is used to dispatch to the right type.
+template<typename Chain, typename T>
+class hetero_chain_segment : private Chain::tag_chain::segment {
+  using me_alias = hetero_chain_segment<Chain, T>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, typename Chain::tag_chain::segment)
+
+  friend Chain;
+
+  T payload;
+
+public:
+  hetero_chain_segment() : super_t{Chain::template index_of<T>}, payload{} {}
+  hetero_chain_segment(const T &v) : super_t{Chain::template index_of<T>}, payload{v} {}
+  hetero_chain_segment(T &&v) : super_t{Chain::template index_of<T>}, payload{std::move(v)} {}
+
+  template<typename... Args>
+  hetero_chain_segment(std::in_place_t, Args&&... args)
+    : super_t{Chain::template index_of<T>}, payload{std::forward<Args>(args)...} {}
+
+  // Copying links is never what you want
+  hetero_chain_segment(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  /// Moving moves the payload AND the links; the source segment is unlinked
+  hetero_chain_segment(me_t &&otr) = default;
+  me_t& operator=(me_t &&otr) = default;
+
+  /// Return the value stored in this segment
+  T& value() { return payload; }
+  const T& value() const { return payload; }
+
+  T& operator*() { return payload; }
+  const T& operator*() const { return payload; }
+
+  T* operator->() { return &payload; }
+  const T* operator->() const { return &payload; }
+
+  /// Check if this segment is part of some chain
+  bool is_linked() const { return super().is_linked(); }
+
+  void unlink() { super().unlink(); }
+};
+
+} // namespace detail
+
+/// A chain whose segments can store values of any of the given types.
+///
+/// Each segment stores a small type index (one byte for up to 256 types)
+/// in front of its value; `visit()` dispatches on that index through a
+/// table of function pointers generated at compile time. This gives
+/// runtime polymorphism without virtual functions, vtable pointers in
+/// the values or heap allocations.
+///
+/// Like chain segments, the segments are allocated by the user, unlink
+/// themselves when they go out of scope and may be moved.
+///
+/// # Example
+///
+/// ```c++
+/// struct circle { float r; };
+/// struct square { float a; };
+///
+/// hetero_chain<circle, square> shapes;
+/// decltype(shapes)::segment<circle> c{circle{1}};
+/// decltype(shapes)::segment<square> s{square{2}};
+/// shapes.link_back(c);
+/// shapes.link_back(s);
+///
+/// float area = 0;
+/// shapes.visit([&](auto &shape) {
+///   if constexpr (std::is_same_v<std::decay_t<decltype(shape)>, circle>)
+///     area += 3.14159f * shape.r * shape.r;
+///   else
+///     area += shape.a * shape.a;
+/// });
+/// ```
+template<typename... Types>
+class hetero_chain {
+  using me_alias = hetero_chain<Types...>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  static_assert(sizeof...(Types) > 0, "hetero_chain needs at least one type.");
+  static_assert(sizeof...(Types) <= 65536, "hetero_chain supports up to 65536 types.");
+
+public:
+  using index_type = std::conditional_t<(sizeof...(Types) <= 256), std::uint8_t, std::uint16_t>;
+
+  /// Index of T in Types...
+  template<typename T>
+  static constexpr index_type index_of = [] {
+    constexpr size_t idx = detail::hetero_type_index<T, Types...>();
+    static_assert(idx < sizeof...(Types), "Type is not part of this hetero_chain.");
+    return static_cast<index_type>(idx);
+  }();
+
+  /// The underlying chain; its values are the type indices
+  using tag_chain = chain<index_type>;
+
+  /// Segment storing a value of type T; allocated by the user
+  template<typename T>
+  using segment = detail::hetero_chain_segment<me_t, T>;
+
+private:
+  tag_chain tags;
+
+  template<typename T, typename Seg, typename Fn>
+  static void dispatch(Seg &seg, Fn &fn) {
+    using seg_t = std::conditional_t<std::is_const_v<Seg>, const segment<T>, segment<T>>;
+    fn(static_cast<seg_t&>(seg).value());
+  }
+
+  template<typename Seg, typename Fn>
+  static void visit_segment(Seg &seg, Fn &fn) {
+    using handler = void (*)(Seg&, Fn&);
+    static constexpr handler table[] = {&dispatch<Types, Seg, Fn>...};
+    table[seg.value()](seg, fn);
+  }
+
+public:
+  hetero_chain() = default;
+
+  hetero_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  hetero_chain(me_t &&otr) = default;
+  me_t& operator=(me_t &&otr) = default;
+
+  void swap(me_t &otr) {
+    tags.swap(otr.tags);
+  }
+
+  /// Size is O(N)
+  size_t size() const { return std::size(tags); }
+  bool empty() const { return std::empty(tags); }
+
+  template<typename T>
+  void link_back(segment<T> &seg) { tags.link_back(seg.super()); }
+
+  template<typename T>
+  void link_front(segment<T> &seg) { tags.link_front(seg.super()); }
+
+  /// Unlinks *all* segments from the chain
+  void clear() { tags.clear(); }
+
+  /// Call fn with a reference to each value in the chain (so fn must
+  /// accept any of the types, e.g. by being a generic lambda).
+  template<typename Fn>
+  void visit(Fn &&fn) {
+    for (auto &seg : tags.lean_segments())
+      visit_segment(seg, fn);
+  }
+
+  template<typename Fn>
+  void visit(Fn &&fn) const {
+    for (const auto &seg : tags.lean_segments())
+      visit_segment(seg, fn);
+  }
+
+  /// Call fn with a reference to the value of each segment of type T
+  template<typename T, typename Fn>
+  void for_each(Fn &&fn) {
+    for (auto &seg : tags.lean_segments())
+      if (seg.value() == index_of<T>)
+        fn(static_cast<segment<T>&>(seg).value());
+  }
+
+  /// The underlying chain of type indices
+  const tag_chain& type_tags() const { return tags; }
+};
+
+} // namespace heapfree
+} // namespace hardwave
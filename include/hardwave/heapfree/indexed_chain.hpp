@@ -0,0 +1,473 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/skip_tower.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+template<typename, std::size_t>
+class indexed_chain;
+
+namespace detail {
+
+template<typename, bool>
+class indexed_chain_iterator;
+
+/// Links of a node in an indexed chain: A skip list tower (see
+/// skip_tower) with the width of each link.
+///
+/// Level 0 is a regular doubly linked ring through all segments and the
+/// chain header; each higher level skips over the segments with lower
+/// towers. width[l] is the number of level 0 steps from this node to
+/// next[l].
+template<std::size_t MaxLevel>
+struct indexed_chain_node : skip_tower<indexed_chain_node<MaxLevel>, MaxLevel> {
+  using me_t = indexed_chain_node<MaxLevel>;
+  using tower_t = skip_tower<me_t, MaxLevel>;
+
+  std::size_t width[MaxLevel]{};
+
+  void take_links(me_t &otr) {
+    for (std::size_t l{0}; l < otr.height; l++)
+      width[l] = otr.width[l];
+    tower_t::take_links(otr);
+  }
+
+  /// Find the node of the chain header, along with the number of level 0
+  /// steps from the header to this node, by walking backwards along the
+  /// highest level of each node; O(log N) on average.
+  /// f is called with each node that spans over this one, along with
+  /// the lowest level at which it does so.
+  template<typename Fn>
+  me_t& walk_to_head(std::size_t &rank, Fn &&fn) {
+    me_t *p{this};
+    std::size_t level{this->height};
+    rank = 0;
+    while (!p->is_head) {
+      me_t *q{p->prev[p->height - 1]};
+      rank += q->width[p->height - 1];
+      p = q;
+      if (p->levels() > level) {
+        fn(*p, level);
+        level = p->levels();
+      }
+    }
+    return *p;
+  }
+};
+
+} // namespace detail
+
+namespace detail {
+
+/// This type stores the actual data contained in indexed chains.
+/// Just like chain segments, they are allocated by the user, are
+/// unlinked when they go out of scope and may be moved.
+///
+/// Each segment contains a skip list tower of MaxLevel levels; so
+/// segments are much larger than regular chain segments.
+template<typename Chain>
+class indexed_chain_segment : private Chain::node_type {
+  HEAPFREE_DECLARE_ME_SUPER(indexed_chain_segment<Chain>, typename Chain::node_type)
+
+  friend Chain;
+  template<typename, bool>
+  friend class detail::indexed_chain_iterator;
+
+  typename Chain::value_type payload;
+
+public:
+  using chain_type = Chain;
+
+  indexed_chain_segment() = default;
+
+  indexed_chain_segment(typename Chain::const_reference v) : payload{v} {}
+  indexed_chain_segment(typename Chain::value_type &&v) : payload{std::move(v)} {}
+
+  template<typename... Args>
+  indexed_chain_segment(std::in_place_t, Args&&... args)
+    : payload{std::forward<Args>(args)...} {}
+
+  // Copying links is never what you want
+  indexed_chain_segment(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  /// Moving moves the payload AND the links; the source segment is unlinked
+  indexed_chain_segment(me_t &&otr) : payload{std::move(otr.payload)} {
+    if (otr.is_linked())
+      super().take_links(otr.super());
+  }
+  me_t& operator=(me_t &&otr) {
+    if (&otr == this)
+      return me();
+    if (is_linked())
+      unlink();
+    payload = std::move(otr.payload);
+    if (otr.is_linked())
+      super().take_links(otr.super());
+    return me();
+  }
+
+  ~indexed_chain_segment() {
+    if (is_linked())
+      unlink();
+  }
+
+  /// Return the value stored in this segment
+  typename Chain::reference value() { return payload; }
+  typename Chain::const_reference value() const { return payload; }
+
+  typename Chain::reference operator*() { return payload; }
+  typename Chain::const_reference operator*() const { return payload; }
+
+  typename Chain::pointer operator->() { return &payload; }
+  typename Chain::const_pointer operator->() const { return &payload; }
+
+  /// Check if this segment is part of some chain
+  bool is_linked() const {
+    return this->height != 0;
+  }
+
+  /// Unlink the segment from its chain; O(log N) on average
+  void unlink() {
+    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a segment that is not linked.");
+    auto &n = super();
+    for (std::size_t l{0}; l < n.height; l++) {
+      n.prev[l]->width[l] += n.width[l] - 1;
+      n.prev[l]->next[l] = n.next[l];
+      n.next[l]->prev[l] = n.prev[l];
+    }
+    std::size_t rank;
+    auto &head = n.walk_to_head(rank, [](auto &spanning, std::size_t level) {
+      for (std::size_t l{level}; l < spanning.levels(); l++)
+        spanning.width[l]--;
+    });
+    static_cast<Chain&>(head).count--;
+    n.height = 0;
+  }
+};
+
+/// Iterator over indexed chains.
+/// This is a bidirectional iterator consisting of a single pointer,
+/// moving along level 0 of the skip list. Just like chain_lean_iterator
+/// it does not know which chain it belongs to, so going past the ends of
+/// the chain can not be detected.
+template<typename Chain, bool Const>
+class indexed_chain_iterator {
+  using me_alias = indexed_chain_iterator<Chain, Const>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool>
+  friend class detail::indexed_chain_iterator;
+  friend Chain;
+
+  using node_t = std::conditional_t<Const, const typename Chain::node_type, typename Chain::node_type>;
+  using seg_t = std::conditional_t<Const, const typename Chain::segment, typename Chain::segment>;
+
+  node_t *pt{nullptr};
+
+  explicit indexed_chain_iterator(node_t &p) : pt{&p} {}
+
+  void assert_nonull(std::string_view activity) const {
+    HEAPFREE_ASSERT(pt != nullptr, "Cannot ", activity, " a null chain operator");
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = typename Chain::value_type;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  indexed_chain_iterator() = default;
+
+  template<bool Const2>
+  indexed_chain_iterator(const indexed_chain_iterator<Chain, Const2> &otr) : pt{otr.pt} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  /// Return the segment this iterator points to
+  seg_t& segment() const {
+    assert_nonull("dereference");
+    HEAPFREE_ASSERT(!pt->is_head, "Cannot dereference chain iterator: its at the end");
+    return static_cast<seg_t&>(*pt);
+  }
+
+  reference operator*() const { return segment().value(); }
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator--() {
+    assert_nonull("decrement");
+    pt = pt->prev[0];
+    return me();
+  }
+  me_t& operator++() {
+    assert_nonull("increment");
+    pt = pt->next[0];
+    return me();
+  }
+
+  me_t operator--(int) {
+    me_t r{me()};
+    --me();
+    return r;
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const indexed_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt == pt;
+  }
+
+  template<bool Const2>
+  bool operator!=(const indexed_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt != pt;
+  }
+};
+
+} // namespace detail
+
+/// A chain with O(log N) positional access.
+///
+/// Regular chains are O(N) for `operator[]`; indexed chains overlay a
+/// skip list on the segments: Each segment gets a tower of links of a
+/// random height (on average 1 1/3 levels, at most MaxLevel) when it is
+/// linked, and every link stores the number of segments it skips. This
+/// allows `operator[]`, `index_of()` and linking at a position in
+/// O(log N) on average; unlinking is O(log N) as well.
+///
+/// The towers are stored in the segments themselves, sized for MaxLevel
+/// levels, so no memory is allocated. Each level is a factor of four
+/// sparser than the one below, so a MaxLevel of L gives logarithmic
+/// performance for up to about 4^L segments; larger chains still work
+/// correctly, but become slower.
+///
+/// The random tower heights are drawn from a small pseudo random number
+/// generator stored in the chain, so behaviour is deterministic.
+///
+/// # Example
+///
+/// ```c++
+/// indexed_chain<int> my_chain;
+/// decltype(my_chain)::segment a{1}, b{2}, c{3};
+/// my_chain.link_back(a);
+/// my_chain.link_back(c);
+/// my_chain.link_at(1, b);   // 1, 2, 3
+///
+/// my_chain[2];               // 3; O(log N)
+/// my_chain.index_of(c);      // 2; O(log N)
+/// ```
+template<typename T, std::size_t MaxLevel = 10>
+class indexed_chain : private detail::indexed_chain_node<MaxLevel> {
+  using me_alias = indexed_chain<T, MaxLevel>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, detail::indexed_chain_node<MaxLevel>)
+
+  static_assert(MaxLevel > 0 && MaxLevel < 256, "MaxLevel must be between 1 and 255.");
+
+public:
+  using node_type = detail::indexed_chain_node<MaxLevel>;
+
+  using value_type      = T;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::indexed_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::indexed_chain_iterator<me_t, true>;
+
+  /// The segment type is allocated by the user and stores the actual data
+  /// See detail::indexed_chain_segment
+  using segment = detail::indexed_chain_segment<me_t>;
+
+private:
+  friend segment;
+
+  size_t count{0};
+  detail::skip_tower_heights<MaxLevel> random_height;
+
+  void reset() {
+    for (size_t l{0}; l < MaxLevel; l++) {
+      this->next[l] = this->prev[l] = &super();
+      this->width[l] = 1;
+    }
+    count = 0;
+  }
+
+  /// Find the node at the given rank (1 is the first segment)
+  node_type& node_at(size_t rank) {
+    node_type *x{&super()};
+    size_t pos{0};
+    for (size_t l{MaxLevel}; l-- > 0;) {
+      while (pos + x->width[l] <= rank) {
+        pos += x->width[l];
+        x = x->next[l];
+      }
+    }
+    return *x;
+  }
+
+public:
+  /// At the start a chain is empty
+  indexed_chain() {
+    this->is_head = true;
+    reset();
+  }
+
+  ~indexed_chain() {
+    clear();
+  }
+
+  indexed_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  indexed_chain(me_t &&otr) : indexed_chain{} {
+    me() = std::move(otr);
+  }
+
+  me_t& operator=(me_t &&otr) {
+    if (&otr == this)
+      return me();
+    clear();
+    if (!std::empty(otr)) {
+      for (size_t l{0}; l < MaxLevel; l++) {
+        this->width[l] = otr.width[l];
+        if (otr.next[l] == &otr.super())
+          continue; // No segment this tall; keep pointing to ourselves
+        this->next[l] = otr.next[l];
+        this->prev[l] = otr.prev[l];
+      }
+      count = otr.count;
+      super().fix_foreign_links();
+      otr.reset();
+    }
+    random_height = otr.random_height;
+    return me();
+  }
+
+  void swap(me_t &otr) {
+    me_t tmp{std::move(otr)};
+    otr = std::move(me());
+    me() = std::move(tmp);
+  }
+
+  /// Size is O(1)
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  /// Link the segment into the chain, so it ends up at position idx;
+  /// idx may be at most size(). O(log N) on average.
+  iterator link_at(size_t idx, segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "Cannot link a segment that is already linked.");
+    HEAPFREE_ASSERT(idx <= count, "Cannot link segment into indexed chain: "
+        "Index ", idx, " is past the end (size ", count, ")");
+    node_type &n = seg.super();
+    n.height = random_height();
+
+    node_type *x{&super()};
+    size_t pos{0};
+    for (size_t l{MaxLevel}; l-- > 0;) {
+      while (pos + x->width[l] <= idx) {
+        pos += x->width[l];
+        x = x->next[l];
+      }
+      if (l < n.height) {
+        n.next[l] = x->next[l];
+        n.prev[l] = x;
+        x->next[l]->prev[l] = &n;
+        x->next[l] = &n;
+        n.width[l] = x->width[l] - (idx - pos);
+        x->width[l] = idx - pos + 1;
+      } else {
+        x->width[l]++;
+      }
+    }
+    count++;
+    return iterator{n};
+  }
+
+  iterator link_back(segment &seg) {
+    return link_at(count, seg);
+  }
+
+  iterator link_front(segment &seg) {
+    return link_at(0, seg);
+  }
+
+  /// Unlinks a single segment from the chain;
+  /// returns an iterator just after the one that was removed.
+  iterator unlink(iterator it) {
+    auto r = std::next(it);
+    it.segment().unlink();
+    return r;
+  }
+
+  /// Unlinks *all* segments from the chain
+  void clear() {
+    node_type *cur{this->next[0]}, *nx;
+    while (cur != &super()) {
+      nx = cur->next[0];
+      cur->height = 0;
+      cur = nx;
+    }
+    reset();
+  }
+
+  /// Position of the given segment in the chain; O(log N) on average.
+  /// The segment must be part of this chain.
+  size_t index_of(const segment &seg) const {
+    HEAPFREE_ASSERT(seg.is_linked(), "Cannot get the index of a segment that is not linked.");
+    size_t rank;
+    auto &head = const_cast<segment&>(seg).super().walk_to_head(rank, [](auto&, size_t) {});
+    HEAPFREE_ASSERT(&head == &super(), "Cannot get the index of a segment "
+        "that is part of a different chain.");
+    return rank - 1;
+  }
+
+  /// O(log N) on average
+  reference operator[](size_type idx) {
+    HEAPFREE_ASSERT(idx < count, "Index ", idx, " out of range for indexed "
+        "chain of size ", count);
+    return static_cast<segment&>(node_at(idx + 1)).value();
+  }
+  const_reference operator[](size_type idx) const {
+    return const_cast<me_t&>(me())[idx];
+  }
+
+  /// Iterator to the segment at the given position; O(log N) on average
+  iterator nth(size_type idx) {
+    HEAPFREE_ASSERT(idx <= count, "Index ", idx, " out of range for indexed "
+        "chain of size ", count);
+    return iterator{node_at(idx + 1)};
+  }
+  const_iterator nth(size_type idx) const {
+    return const_cast<me_t&>(me()).nth(idx);
+  }
+
+  iterator begin() { return iterator{*this->next[0]}; }
+  iterator end() { return iterator{super()}; }
+
+  const_iterator begin() const { return const_iterator{*this->next[0]}; }
+  const_iterator end() const { return const_iterator{super()}; }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *std::prev(end()); }
+  const_reference back() const { return *std::prev(end()); }
+};
+
+} // namespace heapfree
+} // namespace hardwave
@@ -0,0 +1,484 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/chain.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+template<typename Tag = void>
+struct base_hook;
+
+template<typename T, typename Hook = base_hook<>>
+class intrusive_chain;
+
+namespace detail {
+
+template<typename, bool>
+class intrusive_chain_iterator;
+
+} // namespace detail
+
+/// The links needed to make objects of a user defined type part of an
+/// intrusive_chain. Embed one hook per chain the object should be able
+/// to be part of at the same time; the Tag can be used to tell multiple
+/// hooks in the same type apart.
+///
+/// Just like chain segments, hooks unlink themselves when they go out of
+/// scope and may be moved: The moved-to hook takes over the position in
+/// the chain, the moved-from hook is unlinked.
+///
+/// Copying a hook does *not* copy the links; copies start out unlinked
+/// and assigning to a hook does not change its links, so types embedding
+/// hooks can still use the default copy constructor & assignment.
+template<typename Tag = void>
+class chain_hook : private detail::chain_ptr {
+  HEAPFREE_DECLARE_ME_SUPER(chain_hook<Tag>, detail::chain_ptr)
+
+  template<typename, typename>
+  friend class intrusive_chain;
+  template<typename, bool>
+  friend class detail::intrusive_chain_iterator;
+
+  void fix_foreign_links() {
+    if (!is_linked()) return;
+    next->prev = &ptrs();
+    prev->next = &ptrs();
+  }
+
+public:
+  using tag = Tag;
+
+  chain_hook() = default;
+
+  chain_hook(const me_t&) : super_t{} {}
+  me_t& operator=(const me_t&) { return me(); }
+
+  chain_hook(me_t &&otr) : super_t{otr.super()} {
+    otr.next = otr.prev = nullptr;
+    fix_foreign_links();
+  }
+  me_t& operator=(me_t &&otr) {
+    if (&otr == this)
+      return me();
+    if (is_linked())
+      unlink();
+    super() = otr.super();
+    otr.next = otr.prev = nullptr;
+    fix_foreign_links();
+    return me();
+  }
+
+  ~chain_hook() {
+    if (is_linked())
+      unlink();
+  }
+
+  /// Check if this hook is part of some chain
+  bool is_linked() const {
+    return next != nullptr;
+  }
+
+  void unlink() {
+    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a hook that is not linked.");
+    next->prev = prev;
+    prev->next = next;
+    next = prev = nullptr;
+  }
+};
+
+namespace detail {
+
+template<typename>
+struct member_pointer_traits;
+
+template<typename T, typename M>
+struct member_pointer_traits<M T::*> {
+  using object_type = T;
+  using member_type = M;
+};
+
+} // namespace detail
+
+/// Selects the chain_hook member an intrusive_chain uses:
+/// `intrusive_chain<my_type, member_hook<&my_type::some_hook>>`.
+template<auto Member>
+struct member_hook {
+  using value_type = typename detail::member_pointer_traits<decltype(Member)>::object_type;
+  using hook_type = typename detail::member_pointer_traits<decltype(Member)>::member_type;
+
+  static hook_type& to_hook(value_type &v) { return v.*Member; }
+
+  /// Get the object from a pointer to its hook, by subtracting the
+  /// offset of the hook inside the object.
+  static value_type& from_hook(hook_type &h) {
+    return *reinterpret_cast<value_type*>(reinterpret_cast<char*>(&h) - offset);
+  }
+
+private:
+  /// Offset of the hook inside the object; determined on a pointer to a
+  /// suitably aligned, non null address where no object lives. Like using
+  /// offsetof() on types that are not standard layout (see
+  /// HEAPFREE_MEMBER_EVENT_LISTENER), this is not strictly portable but
+  /// works on all relevant compilers as long as the hook is not a member
+  /// of a virtual base class. Computed during dynamic initialization, so
+  /// from_hook() must not be used by the static initializers of other
+  /// translation units.
+  static inline const std::ptrdiff_t offset = [] {
+    constexpr std::uintptr_t addr{alignof(value_type)};
+    auto obj = reinterpret_cast<value_type*>(addr);
+    return reinterpret_cast<char*>(&(obj->*Member)) - reinterpret_cast<char*>(addr);
+  }();
+};
+
+/// Selects a chain_hook base class of the value type as the hook an
+/// intrusive_chain uses; this is the default.
+///
+/// ```
+/// struct my_type : chain_hook<> { ... };
+/// intrusive_chain<my_type> my_chain; // Same as intrusive_chain<my_type, base_hook<>>
+/// ```
+///
+/// Use different tags to derive from multiple hooks:
+///
+/// ```
+/// struct my_type : chain_hook<struct a_tag>, chain_hook<struct b_tag> { ... };
+/// intrusive_chain<my_type, base_hook<a_tag>> chain_a;
+/// ```
+template<typename Tag>
+struct base_hook {};
+
+namespace detail {
+
+template<typename T, typename Tag>
+struct base_hook_accessor {
+  using value_type = T;
+  using hook_type = chain_hook<Tag>;
+
+  static hook_type& to_hook(value_type &v) { return v; }
+  static value_type& from_hook(hook_type &h) { return static_cast<value_type&>(h); }
+};
+
+/// Maps the Hook parameter of intrusive_chain to the type
+/// converting between objects and their hooks
+template<typename T, typename Hook>
+struct intrusive_hook_accessor {
+  using type = Hook;
+};
+
+template<typename T, typename Tag>
+struct intrusive_hook_accessor<T, base_hook<Tag>> {
+  using type = base_hook_accessor<T, Tag>;
+};
+
+/// Iterator over intrusive chains.
+/// This is a bidirectional iterator consisting of a single pointer;
+/// like chain_lean_iterator, it does not know which chain it belongs to,
+/// so going past the ends of the chain can not be detected.
+///
+/// The iterator stays valid as long as the object it points to is
+/// part of the chain.
+template<typename Chain, bool Const>
+class intrusive_chain_iterator {
+  using me_alias = intrusive_chain_iterator<Chain, Const>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool>
+  friend class detail::intrusive_chain_iterator;
+  friend Chain;
+
+  using hook_accessor = typename Chain::hook_accessor;
+  using hook_type = typename Chain::hook_type;
+  using ptr_t = std::conditional_t<Const, const chain_ptr, chain_ptr>;
+
+  ptr_t *pt{nullptr};
+
+  explicit intrusive_chain_iterator(ptr_t &p) : pt{&p} {}
+
+  void assert_nonull(std::string_view activity) const {
+    HEAPFREE_ASSERT(pt != nullptr, "Cannot ", activity, " a null chain operator");
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = typename Chain::value_type;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  intrusive_chain_iterator() = default;
+
+  template<bool Const2>
+  intrusive_chain_iterator(const intrusive_chain_iterator<Chain, Const2> &otr) : pt{otr.pt} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  reference operator*() const {
+    assert_nonull("dereference");
+    auto &h = static_cast<hook_type&>(const_cast<chain_ptr&>(*pt));
+    return hook_accessor::from_hook(h);
+  }
+
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator--() {
+    assert_nonull("decrement");
+    pt = pt->prev;
+    return me();
+  }
+  me_t& operator++() {
+    assert_nonull("increment");
+    pt = pt->next;
+    return me();
+  }
+
+  me_t operator--(int) {
+    me_t r{me()};
+    --me();
+    return r;
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const intrusive_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt == pt;
+  }
+
+  template<bool Const2>
+  bool operator!=(const intrusive_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt != pt;
+  }
+};
+
+} // namespace detail
+
+/// A chain of objects of a user defined type, that contain the
+/// links themselves (in the form of a chain_hook).
+///
+/// Where a chain wraps the payload in a segment, intrusive chains link
+/// the objects directly, so iterating yields `T&`. Since an object may
+/// embed several hooks, it can be part of multiple chains at the same
+/// time; the Hook parameter selects which hook this chain uses.
+///
+/// By default, T must derive from chain_hook<> (see base_hook); use
+/// member_hook to select a hook that is a member of T instead.
+///
+/// The size of intrusive chains is O(N).
+///
+/// # Example
+///
+/// ```c++
+/// struct connection {
+///   int fd;
+///   chain_hook<struct lru_tag> lru;
+///   chain_hook<struct shard_tag> shard;
+/// };
+///
+/// intrusive_chain<connection, member_hook<&connection::lru>> lru_list;
+/// intrusive_chain<connection, member_hook<&connection::shard>> shards[4];
+///
+/// connection c{42};
+/// lru_list.link_front(c);
+/// shards[c.fd % 4].link_back(c);
+///
+/// for (connection &c : lru_list)
+///   ...
+///
+/// // c unlinks itself from both chains when it goes out of scope
+/// ```
+///
+/// # Type erasure
+///
+/// Objects of different types can be stored in the same chain, if they
+/// share a base class containing the hook. Together with a function
+/// pointer in the base class, this stores arbitrary lambdas without
+/// virtual functions or heap allocations (this is what event listeners do):
+///
+/// ```c++
+/// struct handler : chain_hook<> {
+///   function_ptr<void, handler&, int> call;
+/// };
+///
+/// template<typename Fn>
+/// struct lambda_handler : handler {
+///   Fn fn;
+///   lambda_handler(Fn f) : handler{{}, &invoke}, fn{std::move(f)} {}
+///   static void invoke(handler &h, int v) {
+///     static_cast<lambda_handler&>(h).fn(v);
+///   }
+/// };
+///
+/// intrusive_chain<handler> handlers;
+/// lambda_handler a{[](int v) { ... }};
+/// handlers.link_back(a);
+///
+/// for (handler &h : handlers) // Yields handler& directly
+///   h.call(h, 42);
+/// ```
+template<typename T, typename Hook>
+class intrusive_chain : private detail::chain_ptr {
+  using me_alias = intrusive_chain<T, Hook>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, detail::chain_ptr)
+
+public:
+  using hook_accessor = typename detail::intrusive_hook_accessor<T, Hook>::type;
+  using hook_type = typename hook_accessor::hook_type;
+
+private:
+  static_assert(std::is_same_v<typename hook_accessor::value_type, T>,
+      "The hook must belong to the value type of the intrusive chain.");
+
+  // does not work if the chain is empty!
+  void fix_moved_ptrs() {
+    next->prev = prev->next = &ptrs();
+  }
+
+public:
+  using value_type      = T;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::intrusive_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::intrusive_chain_iterator<me_t, true>;
+
+private:
+  static detail::chain_ptr& ptrs_of(value_type &v) {
+    return static_cast<detail::chain_ptr&>(hook_accessor::to_hook(v));
+  }
+
+  static detail::chain_ptr& ptrs_of(const_iterator it) {
+    return const_cast<detail::chain_ptr&>(*it.pt);
+  }
+
+public:
+  /// At the start a chain is empty
+  intrusive_chain() {
+    next = prev = &ptrs();
+  }
+
+  ~intrusive_chain() {
+    clear();
+  }
+
+  intrusive_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  intrusive_chain(me_t &&otr) : intrusive_chain{} {
+    me() = std::move(otr);
+  }
+
+  me_t& operator=(me_t &&otr) {
+    clear();
+    if (!std::empty(otr)) {
+      super() = otr.super();
+      fix_moved_ptrs();
+      otr.next = otr.prev = &otr.ptrs();
+    }
+    return me();
+  }
+
+  void swap(me_t &otr) {
+    if (empty()) {
+      me() = std::move(otr);
+    } else if (std::empty(otr)) {
+      otr = std::move(me());
+    } else {
+      std::swap(super(), otr.super());
+      fix_moved_ptrs();
+      otr.fix_moved_ptrs();
+    }
+  }
+
+  /// Size is O(N)
+  size_t size() const { return std::distance(begin(), end()); }
+  bool empty() const { return next == &ptrs(); }
+
+  /// Check whether the given object is linked into this chain; O(N)
+  bool contains(const value_type &v) const {
+    const detail::chain_ptr &vp = ptrs_of(const_cast<value_type&>(v));
+    if (vp.next == nullptr)
+      return false;
+    for (const detail::chain_ptr *p{vp.next}; true; p = p->next) {
+      if (p == &vp) return false;
+      if (p == &ptrs()) return true;
+    }
+  }
+
+  /// Link the object into the chain, just before pos.
+  /// The object's hook must not be linked for this.
+  iterator link(const_iterator pos, value_type &v) {
+    auto &vp = ptrs_of(v);
+    HEAPFREE_ASSERT(vp.next == nullptr, "Cannot link an object whose hook is already linked.");
+    auto &n = ptrs_of(pos);
+    auto &p = *n.prev;
+    vp.prev = &p;
+    vp.next = &n;
+    n.prev = &vp;
+    p.next = &vp;
+    return iterator{vp};
+  }
+
+  iterator link_back(value_type &v) {
+    return link(end(), v);
+  }
+
+  iterator link_front(value_type &v) {
+    return link(begin(), v);
+  }
+
+  /// Unlinks a single object from the chain;
+  /// returns an iterator just after the one that was removed.
+  iterator unlink(const_iterator it) {
+    HEAPFREE_ASSERT(it != end(), "Cannot unlink the end() iterator.");
+    iterator r{ptrs_of(std::next(it))};
+    hook_accessor::to_hook(const_cast<value_type&>(*it)).unlink();
+    return r;
+  }
+
+  /// Unlinks *all* objects from the chain
+  void clear() {
+    detail::chain_ptr *cur{next}, *nx;
+    next = prev = &ptrs();
+    while (cur != &ptrs()) {
+      nx = cur->next;
+      cur->next = cur->prev = nullptr;
+      cur = nx;
+    }
+  }
+
+  /// Iterator to an object linked into this chain, in O(1).
+  /// The object must be part of this chain.
+  iterator iterator_to(value_type &v) { return iterator{ptrs_of(v)}; }
+  const_iterator iterator_to(const value_type &v) const {
+    return const_iterator{ptrs_of(const_cast<value_type&>(v))};
+  }
+
+  iterator begin() { return iterator{*next}; }
+  iterator end() { return iterator{ptrs()}; }
+
+  const_iterator begin() const { return const_iterator{*next}; }
+  const_iterator end() const { return const_iterator{ptrs()}; }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *std::prev(end()); }
+  const_reference back() const { return *std::prev(end()); }
+};
+
+} // namespace heapfree
+} // namespace hardwave
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstddef>
 #include <iterator>
+#include <type_traits>
 
 namespace hardwave {
 namespace heapfree {
@@ -15,6 +16,9 @@ namespace heapfree {
 /// In addition to that slice() is supported
 /// size, slice and [] are O(N) for bidirectional iterators and O(1) for random access iterators.
 ///
+/// Begin and End may be of different types, e.g. when End is a sentinel
+/// that compares equal to the iterator at the end of the range.
+///
 /// # Example
 ///
 /// ```
@@ -73,8 +77,13 @@ public:
   size_type size() const {
     if (empty()) { // To support value initialized iterators
       return 0;
-    } else {
+    } else if constexpr (std::is_same_v<Begin, End>) {
       return std::distance(b, e);
+    } else { // Sentinel based ranges
+      size_type r{0};
+      for (auto it = b; it != e; ++it)
+        r++;
+      return r;
     }
   }
   bool empty() const { return b == e; }
@@ -0,0 +1,229 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <functional>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/event.hpp"
+#include "hardwave/heapfree/hash_chain.hpp"
+#include "hardwave/heapfree/intrusive_chain.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+/// A least recently used cache of user allocated entries.
+///
+/// Each entry is a hash_chain segment (the index, whose Buckets buckets
+/// are stored inside the cache) with an additional chain_hook (the
+/// recency list, most recently used first). Lookups, touching, insertion
+/// and eviction are all O(1) and nothing is allocated.
+///
+/// Inserting an entry into a full cache evicts the least recently used
+/// entry; so does inserting an entry whose key is already cached (the
+/// old entry is replaced). Evictions fire `on_evict` with the key and
+/// value of the evicted entry after it has been removed from the cache,
+/// so its owner can reclaim the storage. Entries remove themselves from
+/// the cache when they go out of scope (without firing `on_evict`).
+///
+/// The entries point back to the cache, so the cache can not be moved.
+///
+/// # Example
+///
+/// ```c++
+/// using cache_t = lru_cache<int, std::string, 64>;
+/// cache_t cache{2}; // Capacity of two entries
+/// auto listener = on(cache.on_evict, [](const int &k, std::string &v) {
+///   std::cout << "evicted " << k << "\n";
+/// });
+///
+/// cache_t::entry a{1, "a"}, b{2, "b"}, c{3, "c"};
+/// cache.insert(a);
+/// cache.insert(b);
+/// cache.get(1);    // Hit; a is now the most recently used entry
+/// cache.insert(c); // Prints "evicted 2"
+/// cache.get(2);    // nullptr; a miss
+/// ```
+template<typename K, typename V, size_t Buckets, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class lru_cache {
+  using me_alias = lru_cache<K, V, Buckets, Hash, KeyEqual>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  static_assert(Buckets > 0 && (Buckets & (Buckets - 1)) == 0,
+      "The number of buckets of an lru_cache must be a power of two.");
+
+  using index_type = hash_chain<K, V, Hash, KeyEqual>;
+
+public:
+  using key_type = K;
+  using mapped_type = V;
+
+  /// A cache entry; allocated by the user.
+  /// Entries can be moved (also while cached) but not copied.
+  class entry : private index_type::segment {
+    using me_t = entry;
+    using segment_t = typename index_type::segment;
+
+    friend lru_cache;
+
+    chain_hook<> recency;
+    lru_cache *owner{nullptr};
+
+  public:
+    using segment_t::segment_t;
+    using segment_t::key;
+    using segment_t::value;
+    using segment_t::operator*;
+    using segment_t::operator->;
+
+    entry(me_t &&otr)
+      : segment_t{std::move(otr)}, recency{std::move(otr.recency)}, owner{otr.owner} {
+      otr.owner = nullptr;
+    }
+    me_t& operator=(me_t &&otr) = delete;
+
+    ~entry() {
+      if (owner)
+        owner->remove(*this);
+    }
+
+    /// Check if this entry is part of some cache
+    bool is_cached() const { return owner != nullptr; }
+  };
+
+private:
+  using recency_type = intrusive_chain<entry, member_hook<&entry::recency>>;
+
+  typename index_type::bucket buckets[Buckets];
+  index_type index{buckets};
+  recency_type recent;
+  size_t cap;
+  size_t count{0};
+  size_t hit_count{0}, miss_count{0};
+
+  static entry& entry_of(typename index_type::segment &seg) {
+    return static_cast<entry&>(seg);
+  }
+
+  void remove(entry &e) {
+    e.segment_t::unlink();
+    e.recency.unlink();
+    e.owner = nullptr;
+    count--;
+  }
+
+  void evict(entry &e) {
+    remove(e);
+    try_fire(on_evict, e.key(), e.value());
+  }
+
+public:
+  /// Fired with the key and value of every entry evicted from the cache
+  event<const K&, V&> on_evict;
+
+  /// The capacity is the maximum number of entries in the cache
+  lru_cache(size_t capacity = std::numeric_limits<size_t>::max()) : cap{capacity} {
+    HEAPFREE_ASSERT(capacity > 0, "The capacity of an lru_cache must not be zero.");
+  }
+
+  ~lru_cache() {
+    clear();
+  }
+
+  lru_cache(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  size_t capacity() const { return cap; }
+
+  /// Number of get() calls that found (or missed) their key
+  size_t hits() const { return hit_count; }
+  size_t misses() const { return miss_count; }
+
+  void reset_stats() {
+    hit_count = miss_count = 0;
+  }
+
+  /// Look up the value for the given key and mark it as the most
+  /// recently used one; counts as a hit or miss. nullptr on a miss.
+  V* get(const K &k) {
+    auto it = index.find(k);
+    if (it == index.end()) {
+      miss_count++;
+      return nullptr;
+    }
+    hit_count++;
+    entry &e = entry_of(it.segment());
+    touch(e);
+    return &e.value();
+  }
+
+  /// Look up the entry for the given key without changing the recency
+  /// order or the hit and miss counters. nullptr on a miss.
+  entry* peek(const K &k) {
+    auto it = index.find(k);
+    return it == index.end() ? nullptr : &entry_of(it.segment());
+  }
+
+  /// Mark the entry as the most recently used one
+  void touch(entry &e) {
+    HEAPFREE_ASSERT(e.owner == this, "Cannot touch an entry that is not part of this cache.");
+    if (&recent.front() == &e)
+      return;
+    e.recency.unlink();
+    recent.link_front(e);
+  }
+
+  /// Insert the entry as the most recently used one; evicts the entry
+  /// with the same key or, if the cache is full, the least recently
+  /// used entry.
+  void insert(entry &e) {
+    HEAPFREE_ASSERT(!e.is_cached(), "Cannot insert an entry that is already cached.");
+    if (entry *old = peek(e.key()))
+      evict(*old);
+    else if (count >= cap)
+      evict_lru();
+    index.insert(e);
+    recent.link_front(e);
+    e.owner = this;
+    count++;
+  }
+
+  /// Remove the entry from the cache without firing on_evict
+  void erase(entry &e) {
+    HEAPFREE_ASSERT(e.owner == this, "Cannot erase an entry that is not part of this cache.");
+    remove(e);
+  }
+
+  /// Evict the least recently used entry, firing on_evict;
+  /// returns the entry or nullptr if the cache is empty.
+  entry* evict_lru() {
+    if (empty())
+      return nullptr;
+    entry &e = recent.back();
+    evict(e);
+    return &e;
+  }
+
+  /// Remove all entries without firing on_evict
+  void clear() {
+    while (!empty())
+      remove(recent.back());
+  }
+
+  /// The least recently used entry (or nullptr)
+  entry* lru() { return empty() ? nullptr : &recent.back(); }
+
+  /// Iteration over the entries from most to least recently used
+  using iterator = typename recency_type::iterator;
+  using const_iterator = typename recency_type::const_iterator;
+
+  iterator begin() { return recent.begin(); }
+  iterator end() { return recent.end(); }
+  const_iterator begin() const { return recent.begin(); }
+  const_iterator end() const { return recent.end(); }
+};
+
+} // namespace heapfree
+} // namespace hardwave
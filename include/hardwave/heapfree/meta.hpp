@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 
 namespace hardwave {
 namespace heapfree {
@@ -25,5 +26,16 @@ using function_ptr = R (*)(Args...);
   super_t& super() { return static_cast<super_t&>(me()); } \
   const super_t& super() const { return static_cast<const super_t&>(me()); }
 
+/// Hint the processor to load the cache line containing the given
+/// address; does nothing on compilers without __builtin_prefetch
+#if defined(__GNUC__) || defined(__clang__)
+#define HEAPFREE_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define HEAPFREE_PREFETCH(addr) ((void)(addr))
+#endif
+
+/// Cache line size assumed when prefetching
+constexpr std::size_t cache_line_size = 64;
+
 } // namespace heapfree
 } // namespace hardwave
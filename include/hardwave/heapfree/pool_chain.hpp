@@ -0,0 +1,426 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/iterator_range.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+namespace detail {
+
+template<typename, bool, bool>
+class pool_chain_iterator;
+
+/// The smallest unsigned integer type that can represent all indices
+/// of a pool of size N, plus the two special indices (N and N + 1)
+template<std::size_t N>
+using pool_chain_index_t =
+  std::conditional_t<N + 1 <= UINT8_MAX, std::uint8_t,
+    std::conditional_t<N + 1 <= UINT16_MAX, std::uint16_t,
+      std::conditional_t<N + 1 <= UINT32_MAX, std::uint32_t, std::uint64_t>>>;
+
+/// Links used by pool chains: Indices into the pool instead of pointers
+template<typename Index>
+struct pool_chain_ptr {
+  Index next, prev;
+
+  pool_chain_ptr& ptrs() { return *this; }
+  const pool_chain_ptr& ptrs() const { return *this; }
+};
+
+/// This type stores the actual data contained in pool chains.
+/// These segments live in a pool (an array of segments) provided
+/// by the user; which segments are linked into which pool chain
+/// is up to the user.
+///
+/// Since pool segments are referred to by their index, they can
+/// neither be moved nor swapped; their values can be, of course.
+template<typename Chain>
+class pool_chain_segment : private pool_chain_ptr<typename Chain::index_type> {
+  using me_alias = pool_chain_segment<Chain>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, pool_chain_ptr<typename Chain::index_type>)
+
+  typename Chain::value_type payload;
+
+public:
+  using chain_type = Chain;
+
+  template<typename, bool, bool>
+  friend class detail::pool_chain_iterator;
+  friend chain_type;
+
+  pool_chain_segment() : super_t{Chain::unlinked, Chain::unlinked} {}
+
+  pool_chain_segment(const me_t&) = delete;
+  pool_chain_segment& operator=(const me_t&) = delete;
+
+  pool_chain_segment(typename Chain::const_reference v)
+    : super_t{Chain::unlinked, Chain::unlinked}, payload{v} {}
+  typename Chain::reference operator=(typename Chain::const_reference v) {
+    payload = v;
+    return payload;
+  }
+
+  pool_chain_segment(typename Chain::value_type &&v)
+    : super_t{Chain::unlinked, Chain::unlinked}, payload{std::move(v)} {}
+  typename Chain::reference operator=(typename Chain::value_type &&v) {
+    payload = std::move(v);
+    return payload;
+  }
+
+  template<typename... Args>
+  pool_chain_segment(std::in_place_t, Args&&... args)
+    : super_t{Chain::unlinked, Chain::unlinked}, payload{std::forward<Args>(args)...} {}
+
+  /// Return the value stored in this segment
+  typename Chain::reference value() { return payload; }
+  typename Chain::const_reference value() const { return payload; }
+
+  typename Chain::reference operator*() { return payload; }
+  typename Chain::const_reference operator*() const { return payload; }
+
+  typename Chain::pointer operator->() { return &payload; }
+  typename Chain::const_pointer operator->() const { return &payload; }
+
+  /// Check if this segment is part of some chain
+  bool is_linked() const {
+    return super().next != Chain::unlinked;
+  }
+};
+
+/// Iterator over pool chains.
+/// Returned by begin()/end() and segments().begin()/end()
+/// This is a bidirectional iterator.
+///
+/// Validity rules are the same as for chain_iterator.
+template<typename Chain, bool Const, bool Segments = false>
+class pool_chain_iterator {
+  using me_alias = pool_chain_iterator<Chain, Const, Segments>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool, bool>
+  friend class detail::pool_chain_iterator;
+  friend Chain;
+
+  using chain_t = std::conditional_t<Const, const Chain, Chain>;
+  using seg_t = std::conditional_t<Const, const typename chain_t::segment, typename chain_t::segment>;
+  using index_type = typename Chain::index_type;
+
+  chain_t *ch{nullptr};
+  index_type idx{Chain::unlinked};
+
+  pool_chain_iterator(chain_t &c, index_type i) : ch{&c}, idx{i} {}
+
+  void assert_nonull(std::string_view activity) const {
+    HEAPFREE_ASSERT(ch != nullptr, "Cannot ", activity, " a null chain operator");
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = std::conditional_t<Segments,
+    typename chain_t::segment, typename chain_t::value_type>;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  pool_chain_iterator() = default;
+
+  template<bool Const2>
+  pool_chain_iterator(const pool_chain_iterator<Chain, Const2, Segments> &otr)
+      : ch{otr.ch}, idx{otr.idx} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  bool is_end() const {
+    assert_nonull("call is_end()");
+    return idx == Chain::header;
+  }
+
+  /// Index of the segment in the pool
+  index_type index() const { return idx; }
+
+  /// Return the segment this iterator points to, even if the iterator is
+  /// a chain-value iterator
+  seg_t& segment() const {
+    HEAPFREE_ASSERT(!is_end(), "Cannot dereference chain iterator: its at the end");
+    return ch->pool[idx];
+  }
+
+  /// Return the value this iterator points to, even if the iterator is
+  /// a chain-segment iterator
+  std::conditional_t<Const, typename Chain::const_reference, typename Chain::reference>
+  value() const {
+    return segment().value();
+  }
+
+  reference operator*() const {
+    if constexpr (Segments)
+      return segment();
+    else
+      return value();
+  }
+
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator--() {
+    assert_nonull("decrement");
+    idx = ch->ptrs(idx).prev;
+    HEAPFREE_ASSERT(!is_end(), "Can not decrement begin() iterator.");
+    return me();
+  }
+  me_t& operator++() {
+    HEAPFREE_ASSERT(!is_end(), "Can not increment end() iterator.");
+    idx = ch->ptrs(idx).next;
+    return me();
+  }
+
+  me_t operator--(int) {
+    me_t r{me()};
+    --me();
+    return r;
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const pool_chain_iterator<Chain, Const2, Segments> &otr) const {
+    return otr.ch == ch && otr.idx == idx;
+  }
+
+  template<typename T>
+  bool operator!=(const T &otr) const {
+    return !(me() == otr);
+  }
+};
+
+} // namespace detail
+
+/// A chain whose segments live in a fixed size pool.
+///
+/// For systems that preallocate all segments in static arrays anyway,
+/// full pointers as links are wasteful: pool chains link the segments
+/// through their index in the pool instead, using the smallest unsigned
+/// integer type that can represent N (e.g. uint16_t for pools of up to
+/// 65534 segments). For small payloads this cuts the per segment overhead
+/// by up to 4x compared to chain.
+///
+/// The pool is an array of segments provided by the user; several pool
+/// chains may share the same pool, as long as each segment is linked into
+/// at most one of them. The pool must outlive the chains using it.
+///
+/// Since segments do not know the pool they are in, they are not unlinked
+/// automatically; they are unlinked through their chain (or when the chain
+/// is cleared or destroyed) instead. Unlinking a segment through a chain
+/// it is not part of breaks both chains.
+///
+/// ```c++
+/// using my_chain_t = pool_chain<int, 128>;
+/// static my_chain_t::pool_type pool;
+/// static my_chain_t ready{pool}, waiting{pool};
+///
+/// ready.place_back(pool[0], 42);
+/// waiting.link_back(pool[1]);
+/// ```
+template<typename T, std::size_t N>
+class pool_chain : private detail::pool_chain_ptr<detail::pool_chain_index_t<N>> {
+  using me_alias = pool_chain<T, N>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, detail::pool_chain_ptr<detail::pool_chain_index_t<N>>)
+
+public:
+  using value_type      = T;
+  using index_type      = detail::pool_chain_index_t<N>;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::pool_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::pool_chain_iterator<me_t, true>;
+
+  /// The segment type stores the actual data; segments live in the pool.
+  /// See detail::pool_chain_segment
+  using segment = detail::pool_chain_segment<me_t>;
+  using pool_type = std::array<segment, N>;
+
+  /// The index referring to the chain itself (the end of the chain)
+  static constexpr index_type header = N;
+  /// The index stored in segments that are not linked
+  static constexpr index_type unlinked = N + 1;
+
+  template<typename, bool, bool>
+  friend class detail::pool_chain_iterator;
+  friend segment;
+
+private:
+  using ptr_t = detail::pool_chain_ptr<index_type>;
+
+  segment *pool;
+
+  ptr_t& ptrs(index_type i) {
+    return i == header ? super() : static_cast<ptr_t&>(pool[i]);
+  }
+  const ptr_t& ptrs(index_type i) const {
+    return const_cast<me_t&>(me()).ptrs(i);
+  }
+
+public:
+  /// At the start a chain is empty
+  explicit pool_chain(pool_type &p) : super_t{header, header}, pool{p.data()} {}
+  explicit pool_chain(segment (&p)[N]) : super_t{header, header}, pool{p} {}
+
+  ~pool_chain() {
+    clear();
+  }
+
+  pool_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  // Since the segments refer to the chain through the header index,
+  // moving chains is free.
+  pool_chain(me_t &&otr) : super_t{otr.super()}, pool{otr.pool} {
+    otr.next = otr.prev = header;
+  }
+
+  me_t& operator=(me_t &&otr) {
+    clear();
+    super() = otr.super();
+    pool = otr.pool;
+    otr.next = otr.prev = header;
+    return me();
+  }
+
+  void swap(me_t &otr) {
+    std::swap(super(), otr.super());
+    std::swap(pool, otr.pool);
+  }
+
+  // Size is O(N)
+  size_t size() const { return std::distance(begin(), end()); }
+  bool empty() const { return super().next == header; }
+
+  /// Index of the given segment in the pool
+  index_type index_of(const segment &seg) const {
+    HEAPFREE_ASSERT(&seg >= pool && &seg < pool + N,
+        "Segment is not part of the pool of this chain");
+    return static_cast<index_type>(&seg - pool);
+  }
+
+  /// This can be used to link an existing segment into the chain.
+  /// The segment must be part of the pool and must not be linked for this
+  iterator link(const_iterator it, segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "");
+    HEAPFREE_ASSERT(it.ch == this, "");
+    index_type si = index_of(seg), ni = it.idx, pi = ptrs(ni).prev;
+    seg.prev = pi;
+    seg.next = ni;
+    ptrs(ni).prev = si;
+    ptrs(pi).next = si;
+    return {me(), si};
+  }
+
+  iterator link_back(segment &seg) {
+    return link(end(), seg);
+  }
+
+  iterator link_front(segment &seg) {
+    return link(begin(), seg);
+  }
+
+  /// Unlinks a single segment from the chain;
+  /// returns an iterator just after the one that was removed.
+  iterator unlink(iterator it) {
+    HEAPFREE_ASSERT(it.ch == this, "");
+    auto r = std::next(it);
+    unlink(it.segment());
+    return r;
+  }
+
+  /// Unlinks a segment from this chain;
+  /// the segment must be part of this chain.
+  void unlink(segment &seg) {
+    HEAPFREE_ASSERT(seg.is_linked(), "Cannot unlink a segment that is not linked.");
+    static_cast<void>(index_of(seg)); // Makes sure seg is part of the pool
+    ptrs(seg.next).prev = seg.prev;
+    ptrs(seg.prev).next = seg.next;
+    seg.next = seg.prev = unlinked;
+  }
+
+  /// Unlinks *all* segments from the list
+  void clear() {
+    index_type cur{super().next}, nx;
+    super().next = super().prev = header; // Make us self referential
+    while (cur != header) {
+      nx = pool[cur].next;
+      pool[cur].next = pool[cur].prev = unlinked;
+      cur = nx;
+    }
+  }
+
+  /// Assign the value of a segment and link it in one go.
+  /// The parameters are used to construct the value.
+  ///
+  /// ```
+  /// auto &seg = my_chain.place_back(pool[4], ...);
+  /// ```
+  template<typename... Args>
+  segment& place(const_iterator it, segment &seg, Args&&... args) {
+    seg.value() = value_type{std::forward<Args>(args)...};
+    link(it, seg);
+    return seg;
+  }
+
+  template<typename... Args>
+  segment& place_front(segment &seg, Args&&... args) {
+    return place(begin(), seg, std::forward<Args>(args)...);
+  }
+
+  template<typename... Args>
+  segment& place_back(segment &seg, Args&&... args) {
+    return place(end(), seg, std::forward<Args>(args)...);
+  }
+
+  iterator begin() { return {me(), super().next}; }
+  iterator end() { return {me(), header}; }
+
+  const_iterator begin() const { return {me(), super().next}; }
+  const_iterator end() const { return {me(), header}; }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *std::prev(end()); }
+  const_reference back() const { return *std::prev(end()); }
+
+  /// This is a linked list, so numeric access is O(N)
+  reference operator[](size_type idx) {
+    return iterator_range{me()}[idx];
+  }
+  const_reference operator[](size_type idx) const {
+    return const_cast<me_t&>(*this)[idx];
+  }
+
+  /// Constructs an iterator_range, that can be used to iterate over all
+  /// segments in the chain, instead of the values
+  auto segments() {
+    using It = detail::pool_chain_iterator<me_t, false, true>;
+    return iterator_range{It{me(), super().next}, It{me(), header}};
+  }
+  auto segments() const {
+    using It = detail::pool_chain_iterator<me_t, true, true>;
+    return iterator_range{It{me(), super().next}, It{me(), header}};
+  }
+};
+
+} // namespace heapfree
+} // namespace hardwave
@@ -0,0 +1,446 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/iterator_range.hpp"
+#include "hardwave/heapfree/skip_tower.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+template<typename, typename, std::size_t, typename>
+class skip_chain;
+
+namespace detail {
+
+template<typename, bool>
+class skip_chain_iterator;
+
+/// Links of a node in a skip chain: A skip list tower (see skip_tower).
+template<std::size_t MaxLevel>
+struct skip_chain_node : skip_tower<skip_chain_node<MaxLevel>, MaxLevel> {
+  /// O(height); unlike indexed chains nothing above the tower needs fixing
+  void unlink() {
+    for (std::size_t l{0}; l < this->height; l++) {
+      this->prev[l]->next[l] = this->next[l];
+      this->next[l]->prev[l] = this->prev[l];
+    }
+    this->height = 0;
+  }
+};
+
+/// Holds the payload of a skip chain segment; this is the first base
+/// class of the segment, so the key shares a cache line with the lower
+/// levels of the tower during lookups.
+template<typename T>
+struct skip_chain_payload {
+  T payload;
+
+  skip_chain_payload() = default;
+
+  template<typename... Args>
+  skip_chain_payload(std::in_place_t, Args&&... args)
+    : payload{std::forward<Args>(args)...} {}
+};
+
+/// This type stores the actual data contained in skip chains: A key
+/// and a value, stored as std::pair<const K, V> just like std::map does.
+///
+/// Just like chain segments, they are allocated by the user, are
+/// unlinked when they go out of scope and may be moved. The key can not
+/// be changed; since std::pair<const K, V> is not assignable, segments
+/// can be move constructed but not move assigned.
+template<typename Chain>
+class skip_chain_segment
+    : private skip_chain_payload<typename Chain::value_type>
+    , private Chain::node_type {
+  HEAPFREE_DECLARE_ME_SUPER(skip_chain_segment<Chain>, typename Chain::node_type)
+
+  friend Chain;
+  template<typename, bool>
+  friend class detail::skip_chain_iterator;
+
+  using payload_t = skip_chain_payload<typename Chain::value_type>;
+  using payload_t::payload;
+
+public:
+  using chain_type = Chain;
+  using key_type = typename Chain::key_type;
+  using mapped_type = typename Chain::mapped_type;
+
+  skip_chain_segment() = default;
+
+  skip_chain_segment(const key_type &k) : payload_t{std::in_place, k, mapped_type{}} {}
+
+  template<typename M>
+  skip_chain_segment(const key_type &k, M &&v)
+    : payload_t{std::in_place, k, std::forward<M>(v)} {}
+
+  template<typename... Args>
+  skip_chain_segment(std::in_place_t, Args&&... args)
+    : payload_t{std::in_place, std::forward<Args>(args)...} {}
+
+  // Copying links is never what you want
+  skip_chain_segment(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  /// Moving moves the payload AND the links; the source segment is unlinked
+  skip_chain_segment(me_t &&otr) : payload_t{std::in_place, std::move(otr.payload)} {
+    if (otr.is_linked())
+      super().take_links(otr.super());
+  }
+  me_t& operator=(me_t &&otr) = delete;
+
+  ~skip_chain_segment() {
+    if (is_linked())
+      unlink();
+  }
+
+  const key_type& key() const { return payload.first; }
+
+  mapped_type& value() { return payload.second; }
+  const mapped_type& value() const { return payload.second; }
+
+  typename Chain::reference operator*() { return payload; }
+  typename Chain::const_reference operator*() const { return payload; }
+
+  typename Chain::pointer operator->() { return &payload; }
+  typename Chain::const_pointer operator->() const { return &payload; }
+
+  /// Check if this segment is part of some chain
+  bool is_linked() const {
+    return this->height != 0;
+  }
+
+  /// Unlink the segment from its chain; O(1) on average
+  void unlink() {
+    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a segment that is not linked.");
+    super().unlink();
+  }
+};
+
+/// Iterator over skip chains.
+/// This is a bidirectional iterator consisting of a single pointer,
+/// moving along level 0 of the skip list in key order. Just like
+/// chain_lean_iterator it does not know which chain it belongs to, so
+/// going past the ends of the chain can not be detected.
+template<typename Chain, bool Const>
+class skip_chain_iterator {
+  using me_alias = skip_chain_iterator<Chain, Const>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool>
+  friend class detail::skip_chain_iterator;
+  friend Chain;
+
+  using node_t = std::conditional_t<Const, const typename Chain::node_type, typename Chain::node_type>;
+  using seg_t = std::conditional_t<Const, const typename Chain::segment, typename Chain::segment>;
+
+  node_t *pt{nullptr};
+
+  explicit skip_chain_iterator(node_t &p) : pt{&p} {}
+
+  void assert_nonull(std::string_view activity) const {
+    HEAPFREE_ASSERT(pt != nullptr, "Cannot ", activity, " a null chain operator");
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = typename Chain::value_type;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  skip_chain_iterator() = default;
+
+  template<bool Const2>
+  skip_chain_iterator(const skip_chain_iterator<Chain, Const2> &otr) : pt{otr.pt} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  /// Return the segment this iterator points to
+  seg_t& segment() const {
+    assert_nonull("dereference");
+    HEAPFREE_ASSERT(!pt->is_head, "Cannot dereference chain iterator: its at the end");
+    return static_cast<seg_t&>(*pt);
+  }
+
+  reference operator*() const { return *segment(); }
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator--() {
+    assert_nonull("decrement");
+    pt = pt->prev[0];
+    return me();
+  }
+  me_t& operator++() {
+    assert_nonull("increment");
+    pt = pt->next[0];
+    return me();
+  }
+
+  me_t operator--(int) {
+    me_t r{me()};
+    --me();
+    return r;
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const skip_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt == pt;
+  }
+
+  template<bool Const2>
+  bool operator!=(const skip_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt != pt;
+  }
+};
+
+} // namespace detail
+
+/// An ordered multimap built from user allocated segments.
+///
+/// Segments are kept sorted by key using a skip list: Each segment gets
+/// a tower of links of a random height (on average 1 1/3 levels, at most
+/// MaxLevel) when it is inserted, which allows insert, find and
+/// lower_bound in O(log N) expected time. Unlinking a segment only needs
+/// to fix its own tower, which is O(1) on average.
+///
+/// The towers are stored in the segments themselves, sized for MaxLevel
+/// levels, so no memory is allocated. Each level is a factor of four
+/// sparser than the one below, so a MaxLevel of L gives logarithmic
+/// performance for up to about 4^L segments.
+///
+/// Several segments may have equal keys; they are kept in insertion
+/// order. The random tower heights are drawn from a small pseudo random
+/// number generator stored in the chain, so behaviour is deterministic.
+///
+/// # Example
+///
+/// ```c++
+/// skip_chain<int, std::string> timers;
+/// decltype(timers)::segment a{30, "c"}, b{10, "a"}, c{20, "b"};
+/// timers.insert(a);
+/// timers.insert(b);
+/// timers.insert(c);
+///
+/// for (auto &[deadline, name] : timers)
+///   std::cout << deadline << " " << name << "\n"; // 10 a, 20 b, 30 c
+///
+/// timers.lower_bound(15)->second; // "b"
+/// ```
+template<typename K, typename V, std::size_t MaxLevel = 12, typename Compare = std::less<K>>
+class skip_chain : private detail::skip_chain_node<MaxLevel> {
+  using me_alias = skip_chain<K, V, MaxLevel, Compare>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, detail::skip_chain_node<MaxLevel>)
+
+  static_assert(MaxLevel > 0 && MaxLevel < 256, "MaxLevel must be between 1 and 255.");
+
+public:
+  using node_type = detail::skip_chain_node<MaxLevel>;
+
+  using key_type        = K;
+  using mapped_type     = V;
+  using key_compare     = Compare;
+  using value_type      = std::pair<const K, V>;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::skip_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::skip_chain_iterator<me_t, true>;
+
+  /// The segment type is allocated by the user and stores the actual data
+  /// See detail::skip_chain_segment
+  using segment = detail::skip_chain_segment<me_t>;
+
+private:
+  Compare comp;
+  detail::skip_tower_heights<MaxLevel> random_height;
+
+  void reset() {
+    for (size_t l{0}; l < MaxLevel; l++)
+      this->next[l] = this->prev[l] = &super();
+  }
+
+  static const K& key_of(const node_type &n) {
+    return static_cast<const segment&>(n).key();
+  }
+
+  /// Last node at level 0 for which before(node) holds; before must be
+  /// true for a prefix of the chain. If preds is given, it receives the
+  /// last such node on every level.
+  template<typename Before>
+  node_type& search(Before &&before, node_type **preds = nullptr) const {
+    auto *x = const_cast<node_type*>(&super());
+    // First node known not to satisfy before(); lower levels often lead
+    // to the same node, so this saves touching its key again.
+    const node_type *stop{x};
+    for (size_t l{MaxLevel}; l-- > 0;) {
+      while (x->next[l] != stop && before(key_of(*x->next[l])))
+        x = x->next[l];
+      stop = x->next[l];
+      if (preds)
+        preds[l] = x;
+    }
+    return *x;
+  }
+
+  node_type& lower_node(const K &k) const {
+    return *search([&](const K &x) { return comp(x, k); }).next[0];
+  }
+
+  node_type& upper_node(const K &k) const {
+    return *search([&](const K &x) { return !comp(k, x); }).next[0];
+  }
+
+public:
+  /// At the start a chain is empty
+  skip_chain(const Compare &c = Compare{}) : comp{c} {
+    this->is_head = true;
+    reset();
+  }
+
+  ~skip_chain() {
+    clear();
+  }
+
+  skip_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  skip_chain(me_t &&otr) : skip_chain{otr.comp} {
+    me() = std::move(otr);
+  }
+
+  me_t& operator=(me_t &&otr) {
+    if (&otr == this)
+      return me();
+    clear();
+    comp = otr.comp;
+    random_height = otr.random_height;
+    if (std::empty(otr))
+      return me();
+    for (size_t l{0}; l < MaxLevel; l++) {
+      if (otr.next[l] == &otr.super())
+        continue; // No segment this tall; keep pointing to ourselves
+      this->next[l] = otr.next[l];
+      this->prev[l] = otr.prev[l];
+    }
+    super().fix_foreign_links();
+    otr.reset();
+    return me();
+  }
+
+  void swap(me_t &otr) {
+    me_t tmp{std::move(otr)};
+    otr = std::move(me());
+    me() = std::move(tmp);
+  }
+
+  /// Size is O(N)
+  size_t size() const { return std::distance(begin(), end()); }
+  bool empty() const { return this->next[0] == &super(); }
+
+  key_compare key_comp() const { return comp; }
+
+  /// Insert the segment after all segments with an equal key;
+  /// O(log N) expected.
+  iterator insert(segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "Cannot insert a segment that is already linked.");
+    node_type *preds[MaxLevel];
+    search([&](const K &x) { return !comp(seg.key(), x); }, preds);
+
+    node_type &n = seg.super();
+    n.height = random_height();
+    for (size_t l{0}; l < n.height; l++) {
+      n.prev[l] = preds[l];
+      n.next[l] = preds[l]->next[l];
+      n.next[l]->prev[l] = &n;
+      preds[l]->next[l] = &n;
+    }
+    return iterator{n};
+  }
+
+  /// Unlinks a single segment from the chain; O(1) on average.
+  /// Returns an iterator just after the one that was removed.
+  iterator erase(iterator it) {
+    auto r = std::next(it);
+    it.segment().unlink();
+    return r;
+  }
+
+  /// Unlinks all segments with the given key;
+  /// returns the number of segments removed.
+  size_t erase(const K &k) {
+    size_t r{0};
+    for (auto it = lower_bound(k); it != end() && !comp(k, it->first); r++)
+      it = erase(it);
+    return r;
+  }
+
+  /// Unlinks *all* segments from the chain
+  void clear() {
+    node_type *cur{this->next[0]}, *nx;
+    while (cur != &super()) {
+      nx = cur->next[0];
+      cur->height = 0;
+      cur = nx;
+    }
+    reset();
+  }
+
+  /// First segment whose key is not less than k; O(log N) expected
+  iterator lower_bound(const K &k) { return iterator{lower_node(k)}; }
+  const_iterator lower_bound(const K &k) const { return const_iterator{lower_node(k)}; }
+
+  /// First segment whose key is greater than k; O(log N) expected
+  iterator upper_bound(const K &k) { return iterator{upper_node(k)}; }
+  const_iterator upper_bound(const K &k) const { return const_iterator{upper_node(k)}; }
+
+  /// First segment with the given key or end(); O(log N) expected
+  iterator find(const K &k) {
+    auto it = lower_bound(k);
+    return it == end() || comp(k, it->first) ? end() : it;
+  }
+  const_iterator find(const K &k) const {
+    return const_cast<me_t&>(me()).find(k);
+  }
+
+  bool contains(const K &k) const { return find(k) != end(); }
+
+  /// All segments with the given key
+  iterator_range<iterator, iterator> equal_range(const K &k) {
+    return {lower_bound(k), upper_bound(k)};
+  }
+  iterator_range<const_iterator, const_iterator> equal_range(const K &k) const {
+    return {lower_bound(k), upper_bound(k)};
+  }
+
+  iterator begin() { return iterator{*this->next[0]}; }
+  iterator end() { return iterator{super()}; }
+
+  const_iterator begin() const { return const_iterator{*this->next[0]}; }
+  const_iterator end() const { return const_iterator{super()}; }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *std::prev(end()); }
+  const_reference back() const { return *std::prev(end()); }
+};
+
+} // namespace heapfree
+} // namespace hardwave
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace hardwave {
+namespace heapfree {
+namespace detail {
+
+/// Links of a node in a skip list: A tower of next/prev pointers.
+/// Shared by the nodes of indexed_chain and skip_chain; Node is the
+/// derived node type.
+///
+/// Every level is a doubly linked ring through the chain header and all
+/// nodes with a tower at least that high; level 0 contains all nodes.
+template<typename Node, std::size_t MaxLevel>
+struct skip_tower {
+  std::uint8_t height{0}; // 0 if not linked
+  bool is_head{false};
+  Node *next[MaxLevel]{}, *prev[MaxLevel]{};
+
+  /// Number of levels in use; the chain header uses all of them
+  std::size_t levels() const { return is_head ? MaxLevel : height; }
+
+  /// Point the neighbours on every level back at this node
+  void fix_foreign_links() {
+    Node *self{static_cast<Node*>(this)};
+    for (std::size_t l{0}; l < levels(); l++) {
+      next[l]->prev[l] = self;
+      prev[l]->next[l] = self;
+    }
+  }
+
+  /// Take over the position of otr (which must be linked and not a
+  /// chain header); otr is left unlinked
+  void take_links(Node &otr) {
+    height = otr.height;
+    for (std::size_t l{0}; l < height; l++) {
+      next[l] = otr.next[l];
+      prev[l] = otr.prev[l];
+    }
+    otr.height = 0;
+    fix_foreign_links();
+  }
+};
+
+/// Random tower heights for skip lists: Each level is used with a
+/// probability of 1/4 of the level below, which keeps the towers short
+/// while searches still take O(log N) steps on average.
+///
+/// Uses xorshift64 with a fixed seed; the heights only need to be
+/// independent of the keys and positions the user links segments at.
+template<std::size_t MaxLevel>
+class skip_tower_heights {
+  std::uint64_t state{0x9e3779b97f4a7c15u};
+
+public:
+  std::uint8_t operator()() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    std::uint64_t r{state};
+    std::uint8_t h{1};
+    while (h < MaxLevel && (r & 3) == 0) {
+      h++;
+      r >>= 2;
+    }
+    return h;
+  }
+};
+
+} // namespace detail
+} // namespace heapfree
+} // namespace hardwave
@@ -0,0 +1,267 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/chain.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+/// A hierarchical timing wheel: Schedules user allocated timers.
+///
+/// Time is measured in ticks, an unsigned 64 bit integer whose meaning
+/// is up to the user. Each of the Levels levels has SlotsPerLevel slots,
+/// each of which is a chain of timers; the slots of level l cover
+/// SlotsPerLevel^l ticks each. Timers are placed on the lowest level
+/// whose range (SlotsPerLevel^(l+1) ticks) reaches their deadline.
+///
+/// Arming and cancelling timers is O(1) (timers are chain segments, so
+/// destroying an armed timer cancels it). `advance()` fires the expired
+/// timers by splicing whole slots; each time the wheel enters a new slot
+/// on a higher level, the timers of that slot are moved to the lower
+/// levels (cascaded), which happens at most Levels - 1 times per timer.
+/// Empty stretches of time cost about one check per lowest level slot.
+///
+/// Deadlines further away than SlotsPerLevel^Levels ticks are kept in
+/// the slot of the highest level that is visited last and are cascaded
+/// again until they are in range.
+///
+/// Timers are fired in deadline order; timers with the same deadline
+/// are fired in the order they reached the lowest level.
+///
+/// # Example
+///
+/// ```c++
+/// struct request_timeout : timer_wheel<>::timer {
+///   int request_id;
+///   request_timeout(int id) : timer{&expired}, request_id{id} {}
+///   static void expired(timer_wheel<>::timer &t) {
+///     auto &self = static_cast<request_timeout&>(t);
+///     std::cout << "Request " << self.request_id << " timed out\n";
+///   }
+/// };
+///
+/// timer_wheel<> wheel;
+/// request_timeout a{1}, b{2};
+/// wheel.arm(a, 100);
+/// wheel.arm(b, 200);
+/// b.cancel();
+/// wheel.advance(150); // Prints "Request 1 timed out"
+/// ```
+template<size_t Levels = 4, size_t SlotsPerLevel = 256>
+class timer_wheel {
+  using me_alias = timer_wheel<Levels, SlotsPerLevel>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  static_assert(Levels > 0, "A timer_wheel needs at least one level.");
+  static_assert(SlotsPerLevel > 1 && (SlotsPerLevel & (SlotsPerLevel - 1)) == 0,
+      "The number of slots per level of a timer_wheel must be a power of two.");
+
+public:
+  using tick_type = std::uint64_t;
+
+  class timer;
+  using callback_type = function_ptr<void, timer&>;
+
+  /// What each timer stores in its chain segment
+  struct timer_data {
+    tick_type deadline{0};
+    callback_type callback{nullptr};
+  };
+
+  // Timers derive privately from the slot segments, so slot iterators
+  // never leave the wheel; checking them is left to debug builds
+  using slot_type = chain<timer_data, debug_only>;
+
+  /// A timer; allocated by the user.
+  ///
+  /// The callback receives the timer that expired; to associate data
+  /// with a timer, derive from this class and cast the timer back in
+  /// the callback. The timer is disarmed before the callback is called,
+  /// so the callback may arm it again.
+  class timer : private slot_type::segment {
+    using me_t = timer;
+    using segment_t = typename slot_type::segment;
+
+    friend timer_wheel;
+
+  public:
+    timer(callback_type cb = nullptr) : segment_t{timer_data{0, cb}} {}
+
+    timer(const me_t&) = delete;
+    me_t& operator=(const me_t&) = delete;
+
+    /// Moving an armed timer keeps it armed
+    timer(me_t&&) = default;
+    me_t& operator=(me_t&&) = default;
+
+    tick_type deadline() const { return this->value().deadline; }
+
+    callback_type callback() const { return this->value().callback; }
+    void set_callback(callback_type cb) { this->value().callback = cb; }
+
+    bool is_armed() const { return this->is_linked(); }
+
+    /// Disarm the timer; does nothing if it is not armed. O(1)
+    void cancel() {
+      if (is_armed())
+        this->unlink();
+    }
+  };
+
+private:
+  static constexpr size_t mask = SlotsPerLevel - 1;
+  static constexpr size_t bits = [] {
+    size_t r{0};
+    while ((size_t{1} << r) < SlotsPerLevel)
+      r++;
+    return r;
+  }();
+
+  slot_type slots[Levels][SlotsPerLevel];
+  slot_type due; // Timers whose deadline has been reached
+  tick_type current;
+
+  void place(timer &t) {
+    const tick_type d{t.deadline()};
+    if (d <= current) {
+      due.link_back(t);
+      return;
+    }
+    // The slot of level l holding d is cascaded the next time the wheel
+    // enters it; as long as d is less than SlotsPerLevel^(l+1) ticks
+    // away, that is exactly when the block of ticks containing d starts
+    const tick_type delta{d - current};
+    for (size_t l{0}; l < Levels; l++) {
+      const size_t shift{bits * (l + 1)};
+      if (shift >= 64 || (delta >> shift) == 0) {
+        slots[l][(d >> (bits * l)) & mask].link_back(t);
+        return;
+      }
+    }
+    // Out of range; use the slot of the highest level visited last
+    constexpr size_t top_shift{bits * (Levels - 1)};
+    slots[Levels - 1][((current >> top_shift) - 1) & mask].link_back(t);
+  }
+
+  void cascade(slot_type &slot) {
+    slot_type moving;
+    moving.splice(moving.end(), slot);
+    while (!std::empty(moving)) {
+      auto &seg = moving.begin().segment();
+      seg.unlink();
+      place(static_cast<timer&>(seg));
+    }
+  }
+
+  size_t fire_due() {
+    slot_type expired;
+    expired.splice(expired.end(), due);
+    size_t r{0};
+    while (!std::empty(expired)) {
+      auto &seg = expired.begin().segment();
+      seg.unlink();
+      r++;
+      timer &t = static_cast<timer&>(seg);
+      if (t.callback())
+        t.callback()(t);
+    }
+    return r;
+  }
+
+  /// Enter the next tick: cascade higher level slots starting here and
+  /// move the timers of the lowest level slot to due
+  void tick() {
+    current++;
+    for (size_t l{Levels - 1}; l > 0; l--) {
+      const size_t shift{bits * l};
+      if (shift < 64 && (current & ((tick_type{1} << shift) - 1)) == 0)
+        cascade(slots[l][(current >> shift) & mask]);
+    }
+    auto &slot = slots[0][current & mask];
+    due.splice(due.end(), slot);
+  }
+
+public:
+  /// Start at the given time
+  timer_wheel(tick_type now = 0) : current{now} {}
+
+  ~timer_wheel() {
+    clear();
+  }
+
+  timer_wheel(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  /// Moving a wheel moves all armed timers along
+  timer_wheel(me_t&&) = default;
+  me_t& operator=(me_t&&) = default;
+
+  /// The current time
+  tick_type now() const { return current; }
+
+  /// Number of armed timers; O(N + Levels * SlotsPerLevel)
+  size_t size() const {
+    size_t r{std::size(due)};
+    for (const auto &level : slots)
+      for (const auto &slot : level)
+        r += std::size(slot);
+    return r;
+  }
+
+  /// Arm the timer to expire at the given deadline; a timer that is
+  /// already armed is rearmed. Deadlines that have already been reached
+  /// fire on the next call to advance(). O(1)
+  void arm(timer &t, tick_type deadline) {
+    t.cancel();
+    t.value().deadline = deadline;
+    place(t);
+  }
+
+  /// Arm the timer to expire the given number of ticks from now
+  void arm_in(timer &t, tick_type delay) {
+    arm(t, current + delay);
+  }
+
+  /// Move the time forward, firing all timers whose deadline is reached;
+  /// returns the number of timers fired. Timers armed by the callbacks
+  /// whose deadline is already reached are fired after the next tick of
+  /// this call (with now() at that tick); if the new time is already
+  /// reached, they are fired by the next call.
+  size_t advance(tick_type now) {
+    HEAPFREE_ASSERT(now >= current, "Cannot move a timer_wheel back in time: from ",
+        current, " to ", now);
+    size_t r{fire_due()};
+    while (current < now) {
+      // Skip over empty slots in the lowest level; the next tick to
+      // look at is either the next non empty slot or the last one in
+      // this rotation (after which the higher levels need cascading).
+      // Timers the callbacks armed for the past fire on the next tick.
+      tick_type last{std::empty(due) ? current | mask : current};
+      for (tick_type t{current + 1}; t <= last; t++) {
+        if (!std::empty(slots[0][t & mask])) {
+          last = t - 1;
+          break;
+        }
+      }
+      current = std::min(last, now - 1);
+      tick();
+      r += fire_due();
+    }
+    return r;
+  }
+
+  /// Disarm all timers
+  void clear() {
+    due.clear();
+    for (auto &level : slots)
+      for (auto &slot : level)
+        slot.clear();
+  }
+};
+
+} // namespace heapfree
+} // namespace hardwave
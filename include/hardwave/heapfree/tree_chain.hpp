@@ -0,0 +1,666 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/iterator_range.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+template<typename, typename, typename>
+class tree_chain;
+
+namespace detail {
+
+template<typename, bool>
+class tree_chain_iterator;
+
+/// Links of a node in a red-black tree.
+///
+/// The chain header is a node as well: Its left child is the root and
+/// it is the parent of the root (and of itself), so all rotations and
+/// the in-order walk can treat it like any other node, which means no
+/// operation on a node needs to know which tree it belongs to.
+struct tree_chain_node {
+  using me_t = tree_chain_node;
+
+  me_t *parent{nullptr}, *left{nullptr}, *right{nullptr};
+  bool red{false};
+  bool is_head{false};
+
+  bool is_linked() const { return parent != nullptr; }
+
+  static bool is_red(const me_t *n) { return n && n->red; }
+
+  /// The pointer in the parent pointing to c
+  static me_t*& child_slot(me_t *p, const me_t *c) {
+    return p->is_head || p->left == c ? p->left : p->right;
+  }
+
+  static me_t* leftmost(me_t *x) {
+    while (x->left)
+      x = x->left;
+    return x;
+  }
+
+  static me_t* rightmost(me_t *x) {
+    while (x->right)
+      x = x->right;
+    return x;
+  }
+
+  /// In order successor; the header follows the last node
+  static me_t* next(me_t *x) {
+    if (x->right)
+      return leftmost(x->right);
+    me_t *y{x->parent};
+    while (x == y->right) {
+      x = y;
+      y = y->parent;
+    }
+    return y;
+  }
+
+  /// In order predecessor; the predecessor of the header is the last node
+  static me_t* prev(me_t *x) {
+    if (x->left)
+      return rightmost(x->left);
+    me_t *y{x->parent};
+    while (x == y->left) {
+      x = y;
+      y = y->parent;
+    }
+    return y;
+  }
+
+  static void rotate_left(me_t *x) {
+    me_t *y{x->right};
+    x->right = y->left;
+    if (y->left)
+      y->left->parent = x;
+    y->parent = x->parent;
+    child_slot(x->parent, x) = y;
+    y->left = x;
+    x->parent = y;
+  }
+
+  static void rotate_right(me_t *x) {
+    me_t *y{x->left};
+    x->left = y->right;
+    if (y->right)
+      y->right->parent = x;
+    y->parent = x->parent;
+    child_slot(x->parent, x) = y;
+    y->right = x;
+    x->parent = y;
+  }
+
+  void fix_foreign_links() {
+    if (is_head) {
+      if (left)
+        left->parent = this;
+      return;
+    }
+    child_slot(parent, this) = this;
+    if (left)
+      left->parent = this;
+    if (right)
+      right->parent = this;
+  }
+
+  void take_links(me_t &otr) {
+    // child_slot() compares against the old address, so fix the
+    // parent before the links are copied
+    child_slot(otr.parent, &otr) = this;
+    parent = otr.parent;
+    left = otr.left;
+    right = otr.right;
+    red = otr.red;
+    if (left)
+      left->parent = this;
+    if (right)
+      right->parent = this;
+    otr.parent = otr.left = otr.right = nullptr;
+  }
+
+  /// Link this node as child of p (left or right) and rebalance; O(log N)
+  void link(me_t *p, bool as_left) {
+    parent = p;
+    left = right = nullptr;
+    red = true;
+    (as_left || p->is_head ? p->left : p->right) = this;
+
+    me_t *x{this};
+    while (is_red(x->parent)) {
+      me_t *xp{x->parent}, *g{xp->parent}; // xp is red, so it is not the root
+      if (xp == g->left) {
+        me_t *u{g->right};
+        if (is_red(u)) {
+          xp->red = u->red = false;
+          g->red = true;
+          x = g;
+          continue;
+        }
+        if (x == xp->right) {
+          x = xp;
+          rotate_left(x);
+          xp = x->parent;
+        }
+        xp->red = false;
+        g->red = true;
+        rotate_right(g);
+      } else {
+        me_t *u{g->left};
+        if (is_red(u)) {
+          xp->red = u->red = false;
+          g->red = true;
+          x = g;
+          continue;
+        }
+        if (x == xp->left) {
+          x = xp;
+          rotate_right(x);
+          xp = x->parent;
+        }
+        xp->red = false;
+        g->red = true;
+        rotate_left(g);
+      }
+    }
+    if (x->parent->is_head)
+      x->red = false;
+  }
+
+  /// Remove this node from its tree and rebalance; O(log N)
+  void unlink() {
+    me_t *z{this}, *y{this}, *x, *xp;
+    if (!y->left) {
+      x = y->right;
+    } else if (!y->right) {
+      x = y->left;
+    } else {
+      y = leftmost(y->right);
+      x = y->right;
+    }
+
+    if (y != z) {
+      // y is z's successor; move it into z's place
+      z->left->parent = y;
+      y->left = z->left;
+      if (y != z->right) {
+        xp = y->parent;
+        if (x)
+          x->parent = xp;
+        xp->left = x;
+        y->right = z->right;
+        z->right->parent = y;
+      } else {
+        xp = y;
+      }
+      child_slot(z->parent, z) = y;
+      y->parent = z->parent;
+      std::swap(y->red, z->red);
+    } else {
+      xp = z->parent;
+      if (x)
+        x->parent = xp;
+      child_slot(xp, z) = x;
+    }
+
+    if (!z->red) {
+      while (!xp->is_head && !is_red(x)) {
+        if (x == xp->left) {
+          me_t *w{xp->right};
+          if (is_red(w)) {
+            w->red = false;
+            xp->red = true;
+            rotate_left(xp);
+            w = xp->right;
+          }
+          if (!is_red(w->left) && !is_red(w->right)) {
+            w->red = true;
+            x = xp;
+            xp = xp->parent;
+          } else {
+            if (!is_red(w->right)) {
+              w->left->red = false;
+              w->red = true;
+              rotate_right(w);
+              w = xp->right;
+            }
+            w->red = xp->red;
+            xp->red = false;
+            if (w->right)
+              w->right->red = false;
+            rotate_left(xp);
+            break;
+          }
+        } else {
+          me_t *w{xp->left};
+          if (is_red(w)) {
+            w->red = false;
+            xp->red = true;
+            rotate_right(xp);
+            w = xp->left;
+          }
+          if (!is_red(w->right) && !is_red(w->left)) {
+            w->red = true;
+            x = xp;
+            xp = xp->parent;
+          } else {
+            if (!is_red(w->left)) {
+              w->right->red = false;
+              w->red = true;
+              rotate_left(w);
+              w = xp->left;
+            }
+            w->red = xp->red;
+            xp->red = false;
+            if (w->left)
+              w->left->red = false;
+            rotate_right(xp);
+            break;
+          }
+        }
+      }
+      if (x)
+        x->red = false;
+    }
+
+    z->parent = z->left = z->right = nullptr;
+    z->red = false;
+  }
+};
+
+/// This type stores the actual data contained in tree chains: A key
+/// and a value, stored as std::pair<const K, V> just like std::map does.
+///
+/// Just like chain segments, they are allocated by the user, are
+/// unlinked (and the tree rebalanced) when they go out of scope and may
+/// be moved. The key can not be changed; since std::pair<const K, V> is
+/// not assignable, segments can be move constructed but not move assigned.
+template<typename Chain>
+class tree_chain_segment : private tree_chain_node {
+  HEAPFREE_DECLARE_ME_SUPER(tree_chain_segment<Chain>, tree_chain_node)
+
+  friend Chain;
+  template<typename, bool>
+  friend class detail::tree_chain_iterator;
+
+  typename Chain::value_type payload;
+
+public:
+  using chain_type = Chain;
+  using key_type = typename Chain::key_type;
+  using mapped_type = typename Chain::mapped_type;
+
+  tree_chain_segment() = default;
+
+  tree_chain_segment(const key_type &k) : payload{k, mapped_type{}} {}
+
+  template<typename M>
+  tree_chain_segment(const key_type &k, M &&v) : payload{k, std::forward<M>(v)} {}
+
+  template<typename... Args>
+  tree_chain_segment(std::in_place_t, Args&&... args)
+    : payload{std::forward<Args>(args)...} {}
+
+  // Copying links is never what you want
+  tree_chain_segment(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  /// Moving moves the payload AND the links; the source segment is unlinked
+  tree_chain_segment(me_t &&otr) : payload{std::move(otr.payload)} {
+    if (otr.is_linked())
+      super().take_links(otr.super());
+  }
+  me_t& operator=(me_t &&otr) = delete;
+
+  ~tree_chain_segment() {
+    if (is_linked())
+      unlink();
+  }
+
+  const key_type& key() const { return payload.first; }
+
+  mapped_type& value() { return payload.second; }
+  const mapped_type& value() const { return payload.second; }
+
+  typename Chain::reference operator*() { return payload; }
+  typename Chain::const_reference operator*() const { return payload; }
+
+  typename Chain::pointer operator->() { return &payload; }
+  typename Chain::const_pointer operator->() const { return &payload; }
+
+  /// Check if this segment is part of some chain
+  bool is_linked() const { return super().is_linked(); }
+
+  /// Unlink the segment from its chain and rebalance; O(log N)
+  void unlink() {
+    HEAPFREE_ASSERT(is_linked(), "Cannot unlink a segment that is not linked.");
+    super().unlink();
+  }
+};
+
+/// Iterator over tree chains in key order.
+/// This is a bidirectional iterator consisting of a single pointer;
+/// incrementing is O(1) amortized. Just like chain_lean_iterator it does
+/// not know which chain it belongs to, so going past the ends of the
+/// chain can not be detected.
+template<typename Chain, bool Const>
+class tree_chain_iterator {
+  using me_alias = tree_chain_iterator<Chain, Const>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool>
+  friend class detail::tree_chain_iterator;
+  friend Chain;
+
+  using node_t = std::conditional_t<Const, const tree_chain_node, tree_chain_node>;
+  using seg_t = std::conditional_t<Const, const typename Chain::segment, typename Chain::segment>;
+
+  node_t *pt{nullptr};
+
+  explicit tree_chain_iterator(node_t &p) : pt{&p} {}
+
+  void assert_nonull(std::string_view activity) const {
+    HEAPFREE_ASSERT(pt != nullptr, "Cannot ", activity, " a null chain operator");
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = typename Chain::value_type;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  tree_chain_iterator() = default;
+
+  template<bool Const2>
+  tree_chain_iterator(const tree_chain_iterator<Chain, Const2> &otr) : pt{otr.pt} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  /// Return the segment this iterator points to
+  seg_t& segment() const {
+    assert_nonull("dereference");
+    HEAPFREE_ASSERT(!pt->is_head, "Cannot dereference chain iterator: its at the end");
+    return static_cast<seg_t&>(*pt);
+  }
+
+  reference operator*() const { return *segment(); }
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator--() {
+    assert_nonull("decrement");
+    pt = tree_chain_node::prev(const_cast<tree_chain_node*>(pt));
+    return me();
+  }
+  me_t& operator++() {
+    assert_nonull("increment");
+    pt = tree_chain_node::next(const_cast<tree_chain_node*>(pt));
+    return me();
+  }
+
+  me_t operator--(int) {
+    me_t r{me()};
+    --me();
+    return r;
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const tree_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt == pt;
+  }
+
+  template<bool Const2>
+  bool operator!=(const tree_chain_iterator<Chain, Const2> &otr) const {
+    return otr.pt != pt;
+  }
+};
+
+} // namespace detail
+
+/// An ordered multimap built from user allocated segments.
+///
+/// Segments are kept sorted by key in a red-black tree, so insert, find,
+/// lower_bound and unlinking are O(log N) in the worst case; unlike
+/// skip_chain no randomness is involved, which makes this suitable for
+/// real time code. Each segment needs three pointers and a color.
+///
+/// Just like chain segments, the segments are allocated by the user,
+/// unlink themselves (rebalancing the tree) when they go out of scope
+/// and may be moved; no memory is ever allocated.
+///
+/// Several segments may have equal keys; they are kept in insertion
+/// order.
+///
+/// # Example
+///
+/// ```c++
+/// tree_chain<int, std::string> orders;
+/// decltype(orders)::segment a{30, "c"}, b{10, "a"}, c{20, "b"};
+/// orders.insert(a);
+/// orders.insert(b);
+/// orders.insert(c);
+///
+/// for (auto &[price, name] : orders)
+///   std::cout << price << " " << name << "\n"; // 10 a, 20 b, 30 c
+///
+/// orders.lower_bound(15)->second; // "b"
+/// ```
+template<typename K, typename V, typename Compare = std::less<K>>
+class tree_chain : private detail::tree_chain_node {
+  using me_alias = tree_chain<K, V, Compare>;
+  HEAPFREE_DECLARE_ME_SUPER(me_alias, detail::tree_chain_node)
+
+public:
+  using key_type        = K;
+  using mapped_type     = V;
+  using key_compare     = Compare;
+  using value_type      = std::pair<const K, V>;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::tree_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::tree_chain_iterator<me_t, true>;
+
+  /// The segment type is allocated by the user and stores the actual data
+  /// See detail::tree_chain_segment
+  using segment = detail::tree_chain_segment<me_t>;
+
+private:
+  using node = detail::tree_chain_node;
+
+  Compare comp;
+
+  node* root() const { return this->left; }
+
+  static const K& key_of(const node *n) {
+    return static_cast<const segment*>(n)->key();
+  }
+
+  node& lower_node(const K &k) const {
+    auto *r = const_cast<node*>(&super());
+    for (node *x{root()}; x;) {
+      if (!comp(key_of(x), k)) {
+        r = x;
+        x = x->left;
+      } else {
+        x = x->right;
+      }
+    }
+    return *r;
+  }
+
+  node& upper_node(const K &k) const {
+    auto *r = const_cast<node*>(&super());
+    for (node *x{root()}; x;) {
+      if (comp(k, key_of(x))) {
+        r = x;
+        x = x->left;
+      } else {
+        x = x->right;
+      }
+    }
+    return *r;
+  }
+
+  node& first_node() const {
+    return root() ? *node::leftmost(root()) : const_cast<node&>(super());
+  }
+
+  static size_t height_of(const node *x) {
+    return x ? 1 + std::max(height_of(x->left), height_of(x->right)) : 0;
+  }
+
+public:
+  /// At the start a chain is empty
+  tree_chain(const Compare &c = Compare{}) : comp{c} {
+    this->is_head = true;
+    this->parent = &super();
+  }
+
+  ~tree_chain() {
+    clear();
+  }
+
+  tree_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  tree_chain(me_t &&otr) : tree_chain{otr.comp} {
+    me() = std::move(otr);
+  }
+
+  me_t& operator=(me_t &&otr) {
+    if (&otr == this)
+      return me();
+    clear();
+    comp = otr.comp;
+    this->left = otr.left;
+    otr.left = nullptr;
+    super().fix_foreign_links();
+    return me();
+  }
+
+  void swap(me_t &otr) {
+    me_t tmp{std::move(otr)};
+    otr = std::move(me());
+    me() = std::move(tmp);
+  }
+
+  /// Size is O(N)
+  size_t size() const { return std::distance(begin(), end()); }
+  bool empty() const { return root() == nullptr; }
+
+  /// Number of levels in the tree; at most 2*log2(N+1). O(N)
+  size_t height() const { return height_of(root()); }
+
+  key_compare key_comp() const { return comp; }
+
+  /// Insert the segment after all segments with an equal key; O(log N)
+  iterator insert(segment &seg) {
+    HEAPFREE_ASSERT(!seg.is_linked(), "Cannot insert a segment that is already linked.");
+    node *p{&super()};
+    bool as_left{true};
+    for (node *x{root()}; x;) {
+      p = x;
+      as_left = comp(seg.key(), key_of(x));
+      x = as_left ? x->left : x->right;
+    }
+    seg.super().link(p, as_left);
+    return iterator{seg.super()};
+  }
+
+  /// Unlinks a single segment from the chain; O(log N).
+  /// Returns an iterator just after the one that was removed.
+  iterator erase(iterator it) {
+    auto r = std::next(it);
+    it.segment().unlink();
+    return r;
+  }
+
+  /// Unlinks all segments with the given key;
+  /// returns the number of segments removed.
+  size_t erase(const K &k) {
+    size_t r{0};
+    for (auto it = lower_bound(k); it != end() && !comp(k, it->first); r++)
+      it = erase(it);
+    return r;
+  }
+
+  /// Unlinks *all* segments from the chain; O(N) without rebalancing
+  void clear() {
+    node *x{root()};
+    while (x) {
+      if (x->left) {
+        x = x->left;
+      } else if (x->right) {
+        x = x->right;
+      } else {
+        node *p{x->parent};
+        node::child_slot(p, x) = nullptr;
+        x->parent = nullptr;
+        x->red = false;
+        x = p->is_head ? nullptr : p;
+      }
+    }
+  }
+
+  /// First segment whose key is not less than k; O(log N)
+  iterator lower_bound(const K &k) { return iterator{lower_node(k)}; }
+  const_iterator lower_bound(const K &k) const { return const_iterator{lower_node(k)}; }
+
+  /// First segment whose key is greater than k; O(log N)
+  iterator upper_bound(const K &k) { return iterator{upper_node(k)}; }
+  const_iterator upper_bound(const K &k) const { return const_iterator{upper_node(k)}; }
+
+  /// First segment with the given key or end(); O(log N)
+  iterator find(const K &k) {
+    auto it = lower_bound(k);
+    return it == end() || comp(k, it->first) ? end() : it;
+  }
+  const_iterator find(const K &k) const {
+    return const_cast<me_t&>(me()).find(k);
+  }
+
+  bool contains(const K &k) const { return find(k) != end(); }
+
+  /// All segments with the given key
+  iterator_range<iterator, iterator> equal_range(const K &k) {
+    return {lower_bound(k), upper_bound(k)};
+  }
+  iterator_range<const_iterator, const_iterator> equal_range(const K &k) const {
+    return {lower_bound(k), upper_bound(k)};
+  }
+
+  /// begin() is O(log N)
+  iterator begin() { return iterator{first_node()}; }
+  iterator end() { return iterator{super()}; }
+
+  const_iterator begin() const { return const_iterator{first_node()}; }
+  const_iterator end() const { return const_iterator{super()}; }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *std::prev(end()); }
+  const_reference back() const { return *std::prev(end()); }
+};
+
+} // namespace heapfree
+} // namespace hardwave
@@ -0,0 +1,304 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+#include "hardwave/heapfree/meta.hpp"
+#include "hardwave/heapfree/error.hpp"
+#include "hardwave/heapfree/chain.hpp"
+#include "hardwave/heapfree/iterator_range.hpp"
+
+namespace hardwave {
+namespace heapfree {
+
+namespace detail {
+
+template<typename, bool>
+class unrolled_chain_iterator;
+
+/// The payload of unrolled chain segments:
+/// Up to N values stored inline, plus the number of values used.
+///
+/// The values are stored in a plain array, so T must be default
+/// constructible; values beyond size() hold default constructed
+/// or stale values.
+template<typename T, std::size_t N>
+class unrolled_block {
+  using me_t = unrolled_block<T, N>;
+
+  std::size_t count{0};
+  std::array<T, N> values{};
+
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  unrolled_block() = default;
+
+  std::size_t size() const { return count; }
+  static constexpr std::size_t capacity() { return N; }
+  bool empty() const { return count == 0; }
+  bool full() const { return count == N; }
+
+  T& operator[](std::size_t idx) {
+    HEAPFREE_ASSERT(idx < count, "Index out of range for unrolled chain segment");
+    return values[idx];
+  }
+  const T& operator[](std::size_t idx) const {
+    return const_cast<me_t&>(*this)[idx];
+  }
+
+  void push_back(const T &v) {
+    HEAPFREE_ASSERT(!full(), "Unrolled chain segment is full");
+    values[count++] = v;
+  }
+
+  void push_back(T &&v) {
+    HEAPFREE_ASSERT(!full(), "Unrolled chain segment is full");
+    values[count++] = std::move(v);
+  }
+
+  void pop_back() {
+    HEAPFREE_ASSERT(!empty(), "Unrolled chain segment is empty");
+    count--;
+  }
+
+  void clear() { count = 0; }
+
+  /// The values are contiguous in memory
+  T* begin() { return values.data(); }
+  T* end() { return values.data() + count; }
+  const T* begin() const { return values.data(); }
+  const T* end() const { return values.data() + count; }
+};
+
+/// Iterator over the values of an unrolled chain.
+/// Returned by begin()/end(); empty segments are skipped.
+/// This is a forward iterator.
+///
+/// The iterator stays valid as long as the segment pointed to is part
+/// of the chain and the values before it in the segment are not removed.
+template<typename Chain, bool Const>
+class unrolled_chain_iterator {
+  using me_alias = unrolled_chain_iterator<Chain, Const>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  template<typename, bool>
+  friend class detail::unrolled_chain_iterator;
+  friend Chain;
+
+  using block_iterator = std::conditional_t<Const,
+    typename Chain::block_chain::const_iterator,
+    typename Chain::block_chain::iterator>;
+
+  block_iterator bit;
+  std::size_t idx{0};
+
+  explicit unrolled_chain_iterator(block_iterator b) : bit{b} {
+    skip_empty();
+  }
+
+  void skip_empty() {
+    while (!bit.is_end() && bit->empty())
+      ++bit;
+  }
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = typename Chain::value_type;
+  using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+  using reference = std::conditional_t<Const, const value_type&, value_type&>;
+  using iterator_category = std::forward_iterator_tag;
+
+  unrolled_chain_iterator() = default;
+
+  template<bool Const2>
+  unrolled_chain_iterator(const unrolled_chain_iterator<Chain, Const2> &otr)
+      : bit{otr.bit}, idx{otr.idx} {
+    static_assert(Const || Const == Const2, "Cannot copy a const chain iterator "
+        "to one that is not const.");
+  }
+
+  /// Return the segment this iterator points into
+  auto& segment() const { return bit.segment(); }
+
+  reference operator*() const {
+    // chain iterators only hand out mutable references when they are not const
+    auto b{bit};
+    return (*b)[idx];
+  }
+  pointer operator->() const { return &*me(); }
+
+  me_t& operator++() {
+    if (++idx == bit->size()) {
+      idx = 0;
+      ++bit;
+      skip_empty();
+    }
+    return me();
+  }
+
+  me_t operator++(int) {
+    me_t r{me()};
+    ++me();
+    return r;
+  }
+
+  template<bool Const2>
+  bool operator==(const unrolled_chain_iterator<Chain, Const2> &otr) const {
+    return otr.bit == bit && otr.idx == idx;
+  }
+
+  template<typename T>
+  bool operator!=(const T &otr) const {
+    return !(me() == otr);
+  }
+};
+
+} // namespace detail
+
+/// A chain whose segments each store up to N values inline.
+///
+/// Iterating over a chain costs one dependent load per element, which
+/// dominates the cost of traversal for small payloads. Unrolled chains
+/// store a small array of values plus a fill count in every segment,
+/// so traversal scans contiguous memory within each segment and only
+/// follows a link every N values.
+///
+/// The segments are regular chain segments (of a chain of
+/// detail::unrolled_block), so they are allocated by the user (on the
+/// stack, statically...), unlink themselves when they go out of scope and
+/// may be moved freely. Values are added to the last segment with
+/// push_back(); the user links in another segment when it is full.
+///
+/// # Example
+///
+/// ```c++
+/// unrolled_chain<int, 16> my_chain;
+/// decltype(my_chain)::segment a, b;
+/// my_chain.link_back(a);
+///
+/// for (int i = 0; i < 20; i++) {
+///   if (!my_chain.try_push_back(i)) {
+///     my_chain.link_back(b);
+///     my_chain.push_back(i);
+///   }
+/// }
+///
+/// // Fastest way to traverse the chain
+/// long sum = 0;
+/// my_chain.for_each([&](int v) { sum += v; });
+/// ```
+template<typename T, std::size_t N>
+class unrolled_chain {
+  using me_alias = unrolled_chain<T, N>;
+  HEAPFREE_DECLARE_ME(me_alias);
+
+  static_assert(N > 0, "Unrolled chain segments must be able to hold values");
+
+public:
+  using block_type = detail::unrolled_block<T, N>;
+  using block_chain = chain<block_type>;
+
+  using value_type      = T;
+  using size_type       = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference       = value_type&;
+  using pointer         = value_type*;
+  using iterator        = detail::unrolled_chain_iterator<me_t, false>;
+  using const_reference = const value_type&;
+  using const_pointer   = const value_type*;
+  using const_iterator  = detail::unrolled_chain_iterator<me_t, true>;
+
+  /// The segment type is allocated by the user and stores up to N values.
+  /// The values are accessed through the segment: `seg->push_back(v)`, `(*seg)[0]`.
+  using segment = typename block_chain::segment;
+
+private:
+  block_chain blks;
+
+public:
+  unrolled_chain() = default;
+
+  unrolled_chain(const me_t&) = delete;
+  me_t& operator=(const me_t&) = delete;
+
+  unrolled_chain(me_t &&otr) = default;
+  me_t& operator=(me_t &&otr) = default;
+
+  void swap(me_t &otr) {
+    blks.swap(otr.blks);
+  }
+
+  /// The underlying chain of segments
+  block_chain& blocks() { return blks; }
+  const block_chain& blocks() const { return blks; }
+
+  /// Number of values; O(number of segments)
+  size_t size() const {
+    size_t r{0};
+    for (const auto &b : blks.lean_values())
+      r += b.size();
+    return r;
+  }
+
+  bool empty() const { return begin() == end(); }
+
+  /// Link a segment (possibly already containing values) into the chain
+  typename block_chain::iterator link_back(segment &seg) { return blks.link_back(seg); }
+  typename block_chain::iterator link_front(segment &seg) { return blks.link_front(seg); }
+
+  /// Unlinks *all* segments from the chain; the values are kept in the segments
+  void clear() { blks.clear(); }
+
+  /// Append a value to the last segment.
+  /// Returns false if there is no segment or the last one is full.
+  bool try_push_back(const T &v) {
+    if (blks.empty() || blks.back().full())
+      return false;
+    blks.back().push_back(v);
+    return true;
+  }
+
+  /// Append a value to the last segment;
+  /// there must be a segment with space left.
+  void push_back(const T &v) {
+    const bool pushed{try_push_back(v)};
+    HEAPFREE_ASSERT(pushed, "Can not push_back: No space left ",
+        "in the last segment of the unrolled chain");
+  }
+
+  /// Call fn for each value in the chain.
+  /// This is the fastest way to traverse an unrolled chain.
+  template<typename Fn>
+  void for_each(Fn &&fn) {
+    for (auto &b : blks.lean_values())
+      for (auto &v : b)
+        fn(v);
+  }
+  template<typename Fn>
+  void for_each(Fn &&fn) const {
+    for (const auto &b : blks.lean_values())
+      for (const auto &v : b)
+        fn(v);
+  }
+
+  iterator begin() { return iterator{blks.begin()}; }
+  iterator end() { return iterator{blks.end()}; }
+
+  const_iterator begin() const { return const_iterator{blks.begin()}; }
+  const_iterator end() const { return const_iterator{blks.end()}; }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+
+  /// Constructs an iterator_range, that can be used to iterate over all
+  /// segments in the chain, instead of the values
+  auto segments() { return blks.segments(); }
+  auto segments() const { return blks.segments(); }
+};
+
+} // namespace heapfree
+} // namespace hardwave
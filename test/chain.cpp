@@ -1,3 +1,7 @@
+#include <string>
+#include <functional>
+#include <vector>
+#include <algorithm>
 #include <iterator>
 #include <catch2/catch.hpp>
 #include "hardwave/heapfree/chain.hpp"
@@ -386,4 +390,601 @@ TEST_CASE("chain iterator traits") {
   static_assert(std::is_same_v<const int&, const_traits::reference>);
 }
 
+static chain<int, counted> cch;
+using cch_segment = typename decltype(cch)::segment;
+
+TEST_CASE("counted chain size through link & unlink") {
+  REQUIRE(std::size(cch) == 0);
+  {
+    cch_segment a{1}, b{2}, c{3};
+    cch.link_back(a);
+    cch.link_back(b);
+    auto ic = cch.link_front(c);
+    REQUIRE(std::size(cch) == 3);
+
+    cch.unlink(ic);
+    REQUIRE(std::size(cch) == 2);
+
+    a.unlink();
+    REQUIRE(std::size(cch) == 1);
+    REQUIRE_THROWS(a.unlink());
+    REQUIRE(std::size(cch) == 1);
+  }
+  // Destruction of the segments unlinks them
+  REQUIRE(std::size(cch) == 0);
+  REQUIRE(std::empty(cch));
+}
+
+TEST_CASE("counted chain size through segment move & swap") {
+  cch_segment a{1}, b{2}, c{3}, d{4};
+  cch.link_back(a);
+  cch.link_back(b);
+  REQUIRE(std::size(cch) == 2);
+
+  c = std::move(a);
+  REQUIRE(std::size(cch) == 2);
+  cch_segment e{std::move(c)};
+  REQUIRE(std::size(cch) == 2);
+
+  std::swap(b, d);
+  REQUIRE(std::size(cch) == 2);
+  REQUIRE(!b.is_linked());
+  d.unlink();
+  REQUIRE(std::size(cch) == 1);
+
+  // Overwriting a linked segment with an unlinked one unlinks it
+  e = std::move(b);
+  REQUIRE(std::size(cch) == 0);
+}
+
+TEST_CASE("counted chain size through clear") {
+  auto a = cch.place_back(1);
+  auto b = cch.place_back(2);
+  REQUIRE(std::size(cch) == 2);
+  cch.clear();
+  REQUIRE(std::size(cch) == 0);
+  REQUIRE(!a.is_linked());
+
+  // Segments unlinked by clear() may be linked again
+  cch.link_back(a);
+  REQUIRE(std::size(cch) == 1);
+}
+
+TEST_CASE("chain splice") {
+  decltype(ch) ch2;
+  auto a = ch.place_back(test_struct{1, true, 'a'});
+  auto b = ch.place_back(test_struct{2, true, 'b'});
+  auto c = ch.place_back(test_struct{3, true, 'c'});
+  auto d = ch2.place_back(test_struct{4, true, 'd'});
+  auto e = ch2.place_back(test_struct{5, true, 'e'});
+
+  auto str = [](const auto &c) {
+    std::string r;
+    for (const auto &v : c)
+      r += v.c;
+    return r;
+  };
+
+  ch.splice(std::next(ch.begin()), ch2, ch2.begin(), ch2.end());
+  REQUIRE(str(ch) == "adebc");
+  REQUIRE(std::empty(ch2));
+  REQUIRE(&ch.segments()[1] == &d);
+  REQUIRE(&ch.segments()[2] == &e);
+
+  ch2.splice(ch2.end(), ch, std::next(ch.begin(), 3), ch.end());
+  REQUIRE(str(ch) == "ade");
+  REQUIRE(str(ch2) == "bc");
+
+  ch2.splice(ch2.begin(), ch, std::next(ch.begin()));
+  REQUIRE(str(ch) == "ae");
+  REQUIRE(str(ch2) == "dbc");
+
+  // Within the same chain
+  ch2.splice(ch2.begin(), ch2, std::next(ch2.begin()), ch2.end());
+  REQUIRE(str(ch2) == "bcd");
+  ch2.splice(ch2.end(), ch2, ch2.begin());
+  REQUIRE(str(ch2) == "cdb");
+  ch2.splice(ch2.begin(), ch2, ch2.begin(), ch2.begin());
+  REQUIRE(str(ch2) == "cdb");
+
+  ch.splice(ch.end(), ch2);
+  REQUIRE(str(ch) == "aecdb");
+  REQUIRE(std::empty(ch2));
+
+  // Segments still unlink themselves properly
+  c.unlink();
+  REQUIRE(str(ch) == "aedb");
+  REQUIRE(&ch.back() == &b.value());
+}
+
+TEST_CASE("chain split") {
+  auto a = ch.place_back(test_struct{1, true, 'a'});
+  auto b = ch.place_back(test_struct{2, true, 'b'});
+  auto c = ch.place_back(test_struct{3, true, 'c'});
+
+  auto ch2 = ch.split(std::next(ch.begin()));
+  REQUIRE(std::size(ch) == 1);
+  REQUIRE(&ch.front() == &a.value());
+  REQUIRE(std::size(ch2) == 2);
+  REQUIRE(&ch2.front() == &b.value());
+  REQUIRE(&ch2.back() == &c.value());
+
+  auto ch3 = ch2.split(ch2.end());
+  REQUIRE(std::empty(ch3));
+  REQUIRE(std::size(ch2) == 2);
+
+  auto ch4 = ch.split(ch.begin());
+  REQUIRE(std::empty(ch));
+  REQUIRE(std::size(ch4) == 1);
+}
+
+TEST_CASE("chain merge") {
+  chain<std::pair<int, char>> x, y;
+  auto cmp = [](const auto &l, const auto &r) { return l.first < r.first; };
+  auto a = x.place_back(std::in_place, 1, 'a');
+  auto b = x.place_back(std::in_place, 3, 'a');
+  auto c = x.place_back(std::in_place, 3, 'b');
+  auto d = x.place_back(std::in_place, 7, 'a');
+  auto e = y.place_back(std::in_place, 0, 'c');
+  auto f = y.place_back(std::in_place, 2, 'c');
+  auto g = y.place_back(std::in_place, 3, 'c');
+  auto h = y.place_back(std::in_place, 4, 'c');
+  auto i = y.place_back(std::in_place, 5, 'c');
+  auto j = y.place_back(std::in_place, 9, 'c');
+
+  x.merge(y, cmp);
+  REQUIRE(std::empty(y));
+
+  std::string r;
+  for (const auto &v : x)
+    r += std::to_string(v.first) + v.second;
+  REQUIRE(r == "0c1a2c3a3b3c4c5c7a9c");
+  REQUIRE(&x.segments()[5] == &g);
+
+  chain<int> p, q;
+  auto k = q.place_back(2);
+  auto l = q.place_back(1);
+  p.merge(q, std::greater<>{});
+  REQUIRE(std::size(p) == 2);
+  REQUIRE(p.front() == 2);
+  q.merge(p);
+  REQUIRE(std::size(q) == 2);
+  REQUIRE(std::empty(p));
+  REQUIRE_THROWS(q.merge(q));
+}
+
+TEST_CASE("counted chain size through splice, split & merge") {
+  chain<int, counted> x, y;
+  auto a = x.place_back(1);
+  auto b = x.place_back(4);
+  auto c = y.place_back(2);
+  auto d = y.place_back(3);
+
+  x.splice(std::next(x.begin()), y, y.begin(), y.end());
+  REQUIRE(std::size(x) == 4);
+  REQUIRE(std::size(y) == 0);
+  REQUIRE(x.contains(c));
+
+  x.splice(x.begin(), x, std::prev(x.end()));
+  REQUIRE(std::size(x) == 4);
+  REQUIRE(x.front() == 4);
+
+  auto z = x.split(std::next(x.begin(), 2));
+  REQUIRE(std::size(x) == 2);
+  REQUIRE(std::size(z) == 2);
+  REQUIRE(z.contains(c));
+  REQUIRE(z.contains(d));
+  REQUIRE(!x.contains(d));
+
+  b.unlink();
+  x.merge(z);
+  REQUIRE(std::size(x) == 3);
+  REQUIRE(std::size(z) == 0);
+  REQUIRE(x.contains(d));
+  d.unlink();
+  REQUIRE(std::size(x) == 2);
+}
+
+TEST_CASE("chain sort") {
+  chain<std::pair<int, char>> x;
+  auto cmp = [](const auto &l, const auto &r) { return l.first < r.first; };
+  x.sort(cmp);
+  REQUIRE(std::empty(x));
+
+  auto a = x.place_back(std::in_place, 3, 'a');
+  x.sort(cmp);
+  REQUIRE(&x.front() == &a.value());
+
+  auto b = x.place_back(std::in_place, 1, 'b');
+  auto c = x.place_back(std::in_place, 3, 'c');
+  auto d = x.place_back(std::in_place, 0, 'd');
+  auto e = x.place_back(std::in_place, 2, 'e');
+  auto f = x.place_back(std::in_place, 1, 'f');
+  auto g = x.place_back(std::in_place, 3, 'g');
+  auto it = make_chain_it(x, c);
+  x.sort(cmp);
+
+  std::string r;
+  for (const auto &v : x)
+    r += v.second;
+  REQUIRE(r == "dbfeacg");
+  REQUIRE(&*it == &c.value());
+  REQUIRE(&*std::next(it) == &g.value());
+
+  // prev pointers are consistent
+  r.clear();
+  for (auto rit = x.end(); rit != x.begin();)
+    r += (--rit)->second;
+  REQUIRE(r == "gcaefbd");
+
+  x.sort([](const auto &l, const auto &r) { return l.first > r.first; });
+  r.clear();
+  for (const auto &v : x)
+    r += v.second;
+  REQUIRE(r == "acgebfd");
+
+  c.unlink();
+  REQUIRE(std::size(x) == 6);
+  REQUIRE(&x.back() == &d.value());
+
+  chain<int, counted> y;
+  chain<int, counted>::segment ys[100];
+  for (int i = 0; i < 100; i++) {
+    *ys[i] = (i * 37) % 100;
+    y.link_back(ys[i]);
+  }
+  y.sort();
+  REQUIRE(std::size(y) == 100);
+  REQUIRE(std::is_sorted(y.begin(), y.end()));
+  REQUIRE(y.contains(ys[50]));
+}
+
+TEST_CASE("chain relink_by_address") {
+  chain<int, counted> x;
+  chain<int, counted>::segment segs[20];
+  for (int i = 0; i < 20; i++) {
+    *segs[i] = i;
+    x.link_back(segs[(i * 7) % 20]);
+  }
+
+  auto ordered = [&](auto first, auto last) {
+    for (auto it = first; it != last && std::next(it) != last; ++it)
+      if (&it.segment() > &std::next(it).segment())
+        return false;
+    return true;
+  };
+  REQUIRE(!ordered(x.begin(), x.end()));
+
+  decltype(x)::relink_progress progress;
+  size_t calls = 0;
+  while (!x.relink_by_address(progress, 7)) {
+    calls++;
+    REQUIRE(std::size(x) == 20);
+    REQUIRE(std::distance(x.begin(), x.end()) == 20);
+  }
+  REQUIRE(calls > 2);
+  REQUIRE(ordered(x.begin(), x.end()));
+  REQUIRE(x.contains(segs[3]));
+  for (int i = 0; i < 20; i++)
+    REQUIRE(x[i] == i);
+
+  // Modifying the chain in between steps
+  x.clear();
+  for (int i = 0; i < 20; i++)
+    x.link_back(segs[(i * 7) % 20]);
+  REQUIRE(!x.relink_by_address(progress, 10));
+  chain<int, counted>::segment extra{20};
+  x.link_front(extra);
+  while (!x.relink_by_address(progress, 3)) {}
+  REQUIRE(ordered(x.begin(), x.end()));
+  REQUIRE(std::size(x) == 21);
+  extra.unlink();
+
+  // Single step each
+  x.clear();
+  REQUIRE(x.relink_by_address(progress, 1));
+  x.link_back(segs[1]);
+  x.link_back(segs[0]);
+  while (!x.relink_by_address(progress, 1)) {}
+  REQUIRE(&x.segments()[0] == &segs[0]);
+
+  x.clear();
+  for (int i = 0; i < 20; i++)
+    x.link_back(segs[(i * 7) % 20]);
+  REQUIRE(!ordered(x.begin(), x.end()));
+  x.relink_by_address();
+  REQUIRE(ordered(x.begin(), x.end()));
+  REQUIRE(std::size(x) == 20);
+  for (int i = 0; i < 20; i++)
+    REQUIRE(x[i] == i);
+
+  segs[3].unlink();
+  REQUIRE(std::size(x) == 19);
+  REQUIRE(x[3] == 4);
+}
+
+TEST_CASE("chain for_each_prefetch") {
+  chain<int> x;
+  std::string r;
+  auto collect = [&](int v) { r += std::to_string(v); };
+
+  for_each_prefetch(x, collect);
+  REQUIRE(r.empty());
+
+  chain<int>::segment segs[10];
+  for (int i = 0; i < 10; i++) {
+    *segs[i] = i;
+    x.link_back(segs[i]);
+  }
+
+  for_each_prefetch(x, collect);
+  REQUIRE(r == "0123456789");
+
+  const auto &cx = x;
+  int sum = 0;
+  for_each_segment_prefetch(cx, [&](const auto &seg) { sum += *seg; }, 1000);
+  REQUIRE(sum == 45);
+
+  // Unlinking other segments while traversing, including the one that
+  // was just prefetched
+  r.clear();
+  for_each_segment_prefetch(x, [&](auto &seg) {
+    r += std::to_string(*seg);
+    if (*seg == 2) {
+      segs[3].unlink();
+      segs[6].unlink();
+    }
+  });
+  REQUIRE(r == "01245789");
+}
+
+TEST_CASE("chain link_range & unlink_range") {
+  chain<int, counted> x;
+  chain<int, counted>::segment segs[6];
+  for (int i = 0; i < 6; i++)
+    *segs[i] = i;
+  auto str = [&]() {
+    std::string r;
+    for (auto v : x)
+      r += std::to_string(v);
+    return r;
+  };
+
+  auto it = x.link_range(x.end(), segs, segs);
+  REQUIRE(it == x.end());
+  REQUIRE(std::empty(x));
+
+  it = x.link_range(x.end(), std::begin(segs) + 2, std::end(segs));
+  REQUIRE(&it.segment() == &segs[2]);
+  REQUIRE(str() == "2345");
+  REQUIRE(std::size(x) == 4);
+
+  it = x.link_range(std::next(x.begin()), std::begin(segs), std::begin(segs) + 2);
+  REQUIRE(&it.segment() == &segs[0]);
+  REQUIRE(str() == "201345");
+  REQUIRE(std::size(x) == 6);
+  REQUIRE(x.contains(segs[1]));
+  REQUIRE(*std::prev(x.end()) == 5);
+  REQUIRE(*std::prev(x.end(), 5) == 0);
+
+  REQUIRE_THROWS(x.link_range(x.end(), segs));
+  REQUIRE(str() == "201345");
+
+  it = x.unlink_range(std::next(x.begin()), std::prev(x.end()));
+  REQUIRE(*it == 5);
+  REQUIRE(str() == "25");
+  REQUIRE(std::size(x) == 2);
+  REQUIRE(!segs[3].is_linked());
+  REQUIRE(!x.contains(segs[0]));
+
+  it = x.unlink_range(x.begin(), x.begin());
+  REQUIRE(it == x.begin());
+  REQUIRE(std::size(x) == 2);
+
+  // A reversed range is caught before anything is unlinked
+  REQUIRE_THROWS(x.unlink_range(std::next(x.begin()), x.begin()));
+  REQUIRE(str() == "25");
+  REQUIRE(std::size(x) == 2);
+  REQUIRE(segs[5].is_linked());
+
+  std::vector<std::reference_wrapper<chain<int, counted>::segment>> refs{segs[0], segs[3]};
+  x.link_range(x.begin(), refs);
+  REQUIRE(str() == "0325");
+  REQUIRE(std::size(x) == 4);
+
+  x.unlink_range(x.begin(), x.end());
+  REQUIRE(std::empty(x));
+  REQUIRE(std::size(x) == 0);
+  REQUIRE(!segs[2].is_linked());
+}
+
+TEST_CASE("chain unlink_if & partition") {
+  chain<int, counted> x, y;
+  chain<int, counted>::segment segs[10];
+  auto str = [](const auto &c) {
+    std::string r;
+    for (auto v : c)
+      r += std::to_string(v);
+    return r;
+  };
+  auto odd = [](int v) { return v % 2 == 1; };
+
+  REQUIRE(x.unlink_if(odd) == 0);
+  REQUIRE(x.partition(odd, y) == 0);
+  REQUIRE(std::empty(x));
+  REQUIRE(std::empty(y));
+
+  for (int i = 0; i < 10; i++) {
+    *segs[i] = i;
+    x.link_back(segs[i]);
+  }
+
+  REQUIRE(x.unlink_if([](int v) { return v == 0 || v == 5 || v == 9; }) == 3);
+  REQUIRE(str(x) == "1234678");
+  REQUIRE(std::size(x) == 7);
+  REQUIRE(!segs[0].is_linked());
+  REQUIRE(!segs[9].is_linked());
+  REQUIRE(*std::prev(x.end()) == 8);
+  REQUIRE(*std::prev(x.end(), 7) == 1);
+
+  y.link_back(segs[9]);
+  REQUIRE(x.partition(odd, y) == 3);
+  REQUIRE(str(x) == "2468");
+  REQUIRE(str(y) == "9137");
+  REQUIRE(std::size(x) == 4);
+  REQUIRE(std::size(y) == 4);
+  REQUIRE(y.contains(segs[3]));
+  REQUIRE(*std::prev(y.end()) == 7);
+  REQUIRE(*std::prev(y.end(), 3) == 1);
+  REQUIRE_THROWS(x.partition(odd, x));
+
+  REQUIRE(x.partition([](int) { return true; }, y) == 4);
+  REQUIRE(std::empty(x));
+  REQUIRE(str(y) == "91372468");
+
+  REQUIRE(y.unlink_if([](int) { return true; }) == 8);
+  REQUIRE(std::empty(y));
+  REQUIRE(std::size(y) == 0);
+  segs[1].swap(segs[2]); // Both unlinked; must not touch the chains
+  REQUIRE(std::empty(y));
+}
+
+TEST_CASE("counted chain size through chain move & swap") {
+  decltype(cch) ch2;
+  auto a = cch.place_back(1);
+  auto b = cch.place_back(2);
+  auto c = ch2.place_back(3);
+
+  std::swap(cch, ch2);
+  REQUIRE(std::size(cch) == 1);
+  REQUIRE(std::size(ch2) == 2);
+
+  // Segments now refer to their new chain
+  a.unlink();
+  REQUIRE(std::size(ch2) == 1);
+  c.unlink();
+  REQUIRE(std::size(cch) == 0);
+
+  decltype(cch) ch3{std::move(ch2)};
+  REQUIRE(std::size(ch2) == 0);
+  REQUIRE(std::size(ch3) == 1);
+  b.unlink();
+  REQUIRE(std::size(ch3) == 0);
+}
+
+TEST_CASE("chain contains") {
+  decltype(ch) ch2;
+  auto a = ch.place_back();
+  auto b = ch2.place_back();
+  ch_segment c;
+  REQUIRE(ch.contains(a));
+  REQUIRE(!ch.contains(b));
+  REQUIRE(!ch.contains(c));
+  REQUIRE(ch2.contains(b));
+
+  REQUIRE(&make_chain_it(ch, a).segment() == &a);
+  REQUIRE_THROWS(make_chain_it(ch, b));
+  REQUIRE_THROWS(make_chain_it(ch, c));
+}
+
+TEST_CASE("tracked chain contains & make_chain_it") {
+  chain<int, tracked> tch, tch2;
+  using seg_t = typename decltype(tch)::segment;
+  seg_t a{1}, b{2}, c{3};
+  tch.link_back(a);
+  tch.link_back(b);
+  REQUIRE(tch.contains(a));
+  REQUIRE(tch.contains(b));
+  REQUIRE(!tch.contains(c));
+  REQUIRE(!tch2.contains(a));
+
+  REQUIRE(*make_chain_it(tch, b) == 2);
+  REQUIRE_THROWS(make_chain_it(tch, c));
+  REQUIRE_THROWS(make_chain_it(tch2, a));
+
+  b.unlink();
+  REQUIRE(!tch.contains(b));
+
+  // Moving segments and chains carries the owner along
+  seg_t d{std::move(a)};
+  REQUIRE(tch.contains(d));
+  REQUIRE(!tch.contains(a));
+
+  std::swap(tch, tch2);
+  REQUIRE(tch2.contains(d));
+  REQUIRE(!tch.contains(d));
+  REQUIRE(*make_chain_it(tch2, d) == 1);
+
+  tch2.clear();
+  REQUIRE(!tch2.contains(d));
+}
+
+TEST_CASE("chain check policies") {
+  static_assert(chain<int>::checks_enabled);
+  static_assert(chain<int, checked>::checks_enabled);
+  static_assert(!chain<int, unchecked>::checks_enabled);
+#ifdef NDEBUG
+  static_assert(!chain<int, debug_only>::checks_enabled);
+#else
+  static_assert(chain<int, debug_only>::checks_enabled);
+#endif
+
+  chain<int, unchecked> uch;
+  auto a = uch.place_back(1);
+  auto b = uch.place_back(2);
+  auto c = uch.place_front(3);
+  int sum = 0;
+  for (auto v : uch)
+    sum += v;
+  REQUIRE(sum == 6);
+  REQUIRE(&*std::prev(uch.end()) == &b.value());
+  REQUIRE(&uch.segments()[1] == &a);
+  c.unlink();
+  REQUIRE(std::size(uch) == 2);
+
+  chain<int, debug_only> dch;
+  auto d = dch.place_back(1);
+#ifndef NDEBUG
+  REQUIRE_THROWS(++dch.end());
+#endif
+}
+
+TEST_CASE("chain lean iterators") {
+  using It = decltype(ch.lean_values().begin());
+  static_assert(sizeof(It) == sizeof(void*));
+
+  REQUIRE(std::empty(ch.lean_values()));
+  REQUIRE(std::size(ch.lean_values()) == 0);
+
+  auto a = ch.place_back(test_struct{1, true, 'a'});
+  auto b = ch.place_back(test_struct{2, true, 'b'});
+  auto c = ch.place_back(test_struct{3, true, 'c'});
+
+  auto r = ch.lean_values();
+  REQUIRE(!std::empty(r));
+  REQUIRE(std::size(r) == 3);
+  REQUIRE(&r.front() == &a.value());
+  REQUIRE(&r[2] == &c.value());
+
+  int sum = 0;
+  for (const auto &v : r)
+    sum += v.a;
+  REQUIRE(sum == 6);
+
+  auto it = r.begin();
+  REQUIRE(it->c == 'a');
+  REQUIRE(&(++it).segment() == &b);
+  REQUIRE(&*it++ == &b.value());
+  REQUIRE(&*it-- == &c.value());
+  REQUIRE(&*--it == &a.value());
+
+  const auto &cch2 = ch;
+  auto sr = cch2.lean_segments();
+  REQUIRE(std::size(sr) == 3);
+  REQUIRE(&sr[1] == &b);
+  typename decltype(cch2.lean_values())::iterator cit{ch.lean_values().begin()};
+  REQUIRE(cit == ch.lean_values().begin());
+  REQUIRE(cit != ch.lean_values().end());
+}
+
 }
@@ -0,0 +1,190 @@
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/chain.hpp"
+#include "hardwave/heapfree/compact_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+using cch_t = compact_chain<int>;
+using cch_segment = typename cch_t::segment;
+
+template<typename Chain>
+int digits(const Chain &ch) {
+  int r = 0;
+  for (auto v : ch)
+    r = r * 10 + v;
+  return r;
+}
+
+TEST_CASE("compact chain segments are smaller than chain segments") {
+  using fn = void(*)();
+  static_assert(sizeof(compact_chain<fn>::segment) + 8 == sizeof(chain<fn>::segment));
+  static_assert(sizeof(compact_chain<std::int16_t, std::int16_t>::segment) == 6);
+}
+
+TEST_CASE("compact chain link & unlink") {
+  cch_t ch;
+  REQUIRE(std::empty(ch));
+  REQUIRE(std::size(ch) == 0);
+  {
+    cch_segment a{1}, b{2}, c{3}, d{4};
+    auto ia = ch.link_front(a);
+    ch.link_front(b);
+    auto ic = ch.link_back(c);
+    ch.link(ic, d);
+    REQUIRE(digits(ch) == 2143);
+    REQUIRE(std::size(ch) == 4);
+    REQUIRE(ch.front() == 2);
+    REQUIRE(ch.back() == 3);
+    REQUIRE(ch[2] == 4);
+    REQUIRE(&ch.segments()[1] == &a);
+
+    REQUIRE_THROWS(ch.link_back(a));
+
+    auto id = ch.unlink(ia);
+    REQUIRE(*id == 4);
+    REQUIRE(!a.is_linked());
+    REQUIRE(digits(ch) == 243);
+
+    b.unlink();
+    REQUIRE(digits(ch) == 43);
+    REQUIRE_THROWS(b.unlink());
+  }
+  REQUIRE(std::empty(ch));
+}
+
+TEST_CASE("compact chain segment move & swap") {
+  cch_t ch;
+  cch_segment a{1}, b{2}, c{3};
+  ch.link_back(a);
+  ch.link_back(b);
+
+  c = std::move(a);
+  REQUIRE(!a.is_linked());
+  REQUIRE(&ch.segments()[0] == &c);
+  REQUIRE(digits(ch) == 12);
+
+  cch_segment d{std::move(b)};
+  REQUIRE(&ch.segments()[1] == &d);
+  REQUIRE(digits(ch) == 12);
+
+  std::swap(c, d);
+  REQUIRE(&ch.segments()[0] == &d);
+  REQUIRE(&ch.segments()[1] == &c);
+  REQUIRE(digits(ch) == 12);
+
+  std::swap(a, c);
+  REQUIRE(!c.is_linked());
+  REQUIRE(&ch.segments()[1] == &a);
+  REQUIRE(digits(ch) == 12);
+}
+
+TEST_CASE("compact chain move, swap & clear") {
+  cch_t ch, ch2;
+  auto a = ch.place_back(1);
+  auto b = ch.place_back(2);
+  auto c = ch2.place_front(3);
+
+  std::swap(ch, ch2);
+  REQUIRE(digits(ch) == 3);
+  REQUIRE(digits(ch2) == 12);
+
+  cch_t ch3{std::move(ch2)};
+  REQUIRE(std::empty(ch2));
+  REQUIRE(digits(ch3) == 12);
+  REQUIRE(&std::prev(ch3.end()).segment() == &b);
+
+  ch3.clear();
+  REQUIRE(std::empty(ch3));
+  REQUIRE(!a.is_linked());
+  REQUIRE(!b.is_linked());
+}
+
+TEST_CASE("compact chain with 16 bit offsets") {
+  using tiny_t = compact_chain<int, std::int16_t>;
+  struct storage {
+    tiny_t ch;
+    std::array<typename tiny_t::segment, 8> segs;
+  } s;
+
+  int i = 0;
+  for (auto &seg : s.segs) {
+    *seg = i++;
+    s.ch.link_front(seg);
+  }
+  REQUIRE(digits(s.ch) == 76543210);
+
+  // Segments further away than the offset type allows can not be linked
+  static typename tiny_t::segment far;
+  auto dist = reinterpret_cast<std::intptr_t>(&far) - reinterpret_cast<std::intptr_t>(&s.ch);
+  if (dist < -32768 || dist > 32767)
+    REQUIRE_THROWS(s.ch.link_back(far));
+  REQUIRE(!far.is_linked());
+}
+
+TEST_CASE("compact chain offsets out of range leave the chain intact") {
+  // With 8 bit offsets, a node can point 128 bytes back but not forward
+  using byte_t = compact_chain<char, std::int8_t>;
+  using seg_t = typename byte_t::segment;
+  struct storage {
+    byte_t ch;
+    char pad0[60 - sizeof(byte_t)];
+    seg_t z;
+    char pad1[4 - sizeof(seg_t)];
+    seg_t x;
+    char pad2[64 - sizeof(seg_t)];
+    seg_t y;
+  } s;
+  auto at = [&](const void *p) {
+    return reinterpret_cast<std::intptr_t>(p) - reinterpret_cast<std::intptr_t>(&s.ch);
+  };
+  REQUIRE(at(&s.x) == 64);
+  REQUIRE(at(&s.y) == 128);
+
+  *s.x = 1;
+  *s.y = 2;
+  *s.z = 3;
+  s.ch.link_back(s.z);
+  s.ch.link(s.ch.begin(), s.x);
+  s.ch.link(std::next(s.ch.begin()), s.y);
+  REQUIRE(digits(s.ch) == 123);
+
+  // Unlinking x would link the header 128 bytes forward to y
+  REQUIRE_THROWS(s.x.unlink());
+  REQUIRE(s.x.is_linked());
+  REQUIRE(digits(s.ch) == 123);
+
+  // Linking y between the header and z; only the offset from the header
+  // to y is out of range
+  s.y.unlink();
+  REQUIRE_THROWS(s.ch.link(s.ch.begin(), s.y));
+  REQUIRE(!s.y.is_linked());
+  REQUIRE(digits(s.ch) == 13);
+}
+
+TEST_CASE("compact chain iterators") {
+  cch_t ch;
+  auto a = ch.place_back(1);
+  auto b = ch.place_back(2);
+
+  auto it = ch.begin();
+  REQUIRE(&*it++ == &a.value());
+  REQUIRE(&it.segment() == &b);
+  REQUIRE(++it == ch.end());
+  REQUIRE_THROWS(*it);
+  REQUIRE_THROWS(++it);
+  REQUIRE(&*--it == &b.value());
+  --it;
+  REQUIRE_THROWS(--it);
+
+  const cch_t &cch = ch;
+  typename cch_t::const_iterator cit{ch.begin()};
+  REQUIRE(cit == cch.begin());
+  REQUIRE(std::size(cch.segments()) == 2);
+}
+
+}
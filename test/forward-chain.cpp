@@ -0,0 +1,189 @@
+#include <iterator>
+#include <utility>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/forward_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+using fch_t = forward_chain<int>;
+using fch_segment = typename fch_t::segment;
+
+template<typename Chain>
+int sum(const Chain &ch) {
+  int r = 0;
+  for (auto v : ch)
+    r = r * 10 + v;
+  return r;
+}
+
+TEST_CASE("forward chain segment is smaller than chain segment") {
+  static_assert(sizeof(fch_segment) == sizeof(void*) + sizeof(void*));
+}
+
+TEST_CASE("forward chain empty") {
+  fch_t ch;
+  REQUIRE(std::empty(ch));
+  REQUIRE(std::size(ch) == 0);
+  REQUIRE(ch.begin() == ch.end());
+  REQUIRE(std::empty(ch.segments()));
+  REQUIRE_THROWS(ch.pop_front());
+  REQUIRE_THROWS(ch.back());
+}
+
+TEST_CASE("forward chain link & unlink") {
+  fch_t ch;
+  {
+    fch_segment a{1}, b{2}, c{3}, d{4};
+    ch.link_back(a);
+    ch.link_back(b);
+    ch.link_front(c);
+    auto ia = ch.segments().begin();
+    REQUIRE(&*ia == &c);
+    ch.link_after(std::next(ch.begin()), d);
+    REQUIRE(sum(ch) == 3142);
+    REQUIRE(std::size(ch) == 4);
+    REQUIRE(ch.front() == 3);
+    REQUIRE(ch.back() == 2);
+    REQUIRE(ch[2] == 4);
+
+    REQUIRE_THROWS(ch.link_back(a));
+
+    // Unlinking the last segment fixes the tail
+    b.unlink();
+    REQUIRE(!b.is_linked());
+    REQUIRE(ch.back() == 4);
+    REQUIRE(sum(ch) == 314);
+    ch.link_back(b);
+    REQUIRE(sum(ch) == 3142);
+
+    auto it = ch.unlink_after(ch.begin());
+    REQUIRE(*it == 4);
+    REQUIRE(!a.is_linked());
+    REQUIRE(sum(ch) == 342);
+    REQUIRE_THROWS(a.unlink());
+  }
+  // Segments are unlinked when going out of scope
+  REQUIRE(std::empty(ch));
+  REQUIRE_THROWS(ch.back());
+}
+
+TEST_CASE("forward chain as a queue") {
+  fch_t ch;
+  fch_segment a{1}, b{2}, c{3};
+  ch.link_back(a);
+  ch.link_back(b);
+  REQUIRE(&ch.pop_front() == &a);
+  ch.link_back(c);
+  ch.link_back(a);
+  REQUIRE(sum(ch) == 231);
+  REQUIRE(*ch.pop_front() == 2);
+  REQUIRE(*ch.pop_front() == 3);
+  REQUIRE(*ch.pop_front() == 1);
+  REQUIRE(std::empty(ch));
+  REQUIRE(!a.is_linked());
+
+  ch.link_back(b);
+  REQUIRE(ch.back() == 2);
+  REQUIRE(ch.front() == 2);
+}
+
+TEST_CASE("forward chain segment move & swap") {
+  fch_t ch;
+  fch_segment a{1}, b{2}, c{3};
+  ch.link_back(a);
+  ch.link_back(b);
+
+  fch_segment d{std::move(b)};
+  REQUIRE(!b.is_linked());
+  REQUIRE(&ch.segments()[1] == &d);
+  REQUIRE(ch.back() == 2);
+  fch_segment e{5};
+  ch.link_back(e);
+  REQUIRE(sum(ch) == 125);
+
+  c = std::move(a);
+  REQUIRE(&ch.segments()[0] == &c);
+  REQUIRE(sum(ch) == 125);
+
+  // Payload and links are swapped, so the order of values stays the same
+  std::swap(c, e);
+  REQUIRE(sum(ch) == 125);
+  REQUIRE(&ch.segments()[0] == &e);
+  REQUIRE(&ch.segments()[2] == &c);
+
+  std::swap(e, a);
+  REQUIRE(!e.is_linked());
+  REQUIRE(&ch.segments()[0] == &a);
+  REQUIRE(sum(ch) == 125);
+
+  std::swap(c, b);
+  REQUIRE(&ch.segments()[2] == &b);
+  REQUIRE(ch.back() == 5);
+}
+
+TEST_CASE("forward chain place & clear") {
+  fch_t ch;
+  auto a = ch.place_back(1);
+  auto b = ch.place_front(2);
+  auto c = ch.place_back(std::in_place, 3);
+  REQUIRE(sum(ch) == 213);
+
+  ch.clear();
+  REQUIRE(std::empty(ch));
+  REQUIRE(!a.is_linked());
+  REQUIRE(!c.is_linked());
+  ch.link_back(c);
+  REQUIRE(sum(ch) == 3);
+}
+
+TEST_CASE("forward chain move & swap") {
+  fch_t ch, ch2;
+  auto a = ch.place_back(1);
+  auto b = ch.place_back(2);
+
+  fch_t ch3{std::move(ch)};
+  REQUIRE(std::empty(ch));
+  REQUIRE(sum(ch3) == 12);
+  auto c = ch3.place_back(3);
+  REQUIRE(sum(ch3) == 123);
+
+  // The tail still points to the right chain
+  c.unlink();
+  REQUIRE(ch3.back() == 2);
+
+  auto d = ch2.place_back(4);
+  std::swap(ch2, ch3);
+  REQUIRE(sum(ch2) == 12);
+  REQUIRE(sum(ch3) == 4);
+  b.unlink();
+  REQUIRE(ch2.back() == 1);
+
+  ch = std::move(ch2);
+  REQUIRE(std::empty(ch2));
+  REQUIRE(sum(ch) == 1);
+}
+
+TEST_CASE("forward chain iterators") {
+  fch_t ch;
+  auto a = ch.place_back(1);
+  auto b = ch.place_back(2);
+
+  auto it = ch.begin();
+  REQUIRE(&*it++ == &a.value());
+  REQUIRE(&it.segment() == &b);
+  REQUIRE(++it == ch.end());
+  REQUIRE_THROWS(*it);
+  REQUIRE_THROWS(++it);
+
+  const fch_t &cch = ch;
+  typename fch_t::const_iterator cit{ch.begin()};
+  REQUIRE(cit == cch.begin());
+  REQUIRE(std::size(cch.segments()) == 2);
+
+  using traits = std::iterator_traits<typename fch_t::iterator>;
+  static_assert(std::is_same_v<std::forward_iterator_tag, traits::iterator_category>);
+  static_assert(std::is_same_v<int&, traits::reference>);
+}
+
+}
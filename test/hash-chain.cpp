@@ -0,0 +1,231 @@
+#include <string>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/hash_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+// Sorted contents, since hash chains are unordered
+template<typename Chain>
+std::string str(const Chain &ch) {
+  std::vector<std::pair<int, std::string>> v;
+  for (const auto &[k, val] : ch)
+    v.emplace_back(k, val);
+  std::sort(v.begin(), v.end());
+  std::string r;
+  for (const auto &[k, val] : v)
+    r += std::to_string(k) + val;
+  return r;
+}
+
+using map_t = hash_chain<int, std::string>;
+
+TEST_CASE("hash chain insert & lookup") {
+  map_t::bucket buckets[8];
+  map_t ch{buckets};
+  REQUIRE(std::empty(ch));
+  REQUIRE(ch.bucket_count() == 8);
+  REQUIRE(ch.begin() == ch.end());
+  static_assert(sizeof(map_t::bucket) == 2 * sizeof(void*));
+
+  map_t::bucket odd[6];
+  REQUIRE_THROWS(map_t{odd});
+
+  // 1 and 9 share a bucket
+  map_t::segment a{1, "a"}, b{9, "b"}, c{2, "c"}, d{9, "d"};
+  auto ia = ch.insert(a);
+  REQUIRE(&*ia == &*a);
+  ch.insert(b);
+  ch.insert(c);
+  REQUIRE(str(ch) == "1a2c9b");
+  REQUIRE(std::size(ch) == 3);
+  REQUIRE_THROWS(ch.insert(a));
+
+  REQUIRE(ch.find(1)->second == "a");
+  REQUIRE(ch.find(9)->second == "b");
+  REQUIRE(ch.find(17) == ch.end());
+  REQUIRE(ch.contains(2));
+  REQUIRE(!ch.contains(3));
+  const auto &cch = ch;
+  REQUIRE(cch.find(2)->second == "c");
+
+  ch.insert(d);
+  REQUIRE(ch.count(9) == 2);
+  REQUIRE(ch.find(9)->second == "d");
+
+  // Iterating from a found segment covers the rest of the table
+  std::ptrdiff_t n = 0;
+  for (auto it = ch.begin(); it != ch.find(2); ++it)
+    n++;
+  REQUIRE(std::distance(ch.find(2), ch.end()) == 4 - n);
+
+  b.unlink();
+  REQUIRE(ch.count(9) == 1);
+  REQUIRE(str(ch) == "1a2c9d");
+  REQUIRE_THROWS(b.unlink());
+
+  ch.erase(ch.find(2));
+  REQUIRE(!c.is_linked());
+  REQUIRE(str(ch) == "1a9d");
+
+  REQUIRE(ch.erase(9) == 1);
+  REQUIRE(ch.erase(9) == 0);
+  REQUIRE(str(ch) == "1a");
+
+  {
+    map_t::segment e{5, "e"};
+    ch.insert(e);
+    REQUIRE(str(ch) == "1a5e");
+  }
+  REQUIRE(str(ch) == "1a");
+
+  ch.clear();
+  REQUIRE(std::empty(ch));
+  REQUIRE(!a.is_linked());
+}
+
+TEST_CASE("hash chain segment & chain move") {
+  map_t::bucket buckets[4];
+  map_t ch{buckets};
+  map_t::segment a{1, "a"}, b{5, "b"}, c{9, "c"};
+  ch.insert(a);
+  ch.insert(b);
+  ch.insert(c);
+
+  {
+    map_t::segment b2{std::move(b)};
+    REQUIRE(!b.is_linked());
+    REQUIRE(&ch.find(5).segment() == &b2);
+    REQUIRE(str(ch) == "1a5b9c");
+    map_t::segment c2{std::move(c)}; // First in its bucket
+    REQUIRE(&ch.find(9).segment() == &c2);
+    REQUIRE(str(ch) == "1a5b9c");
+  }
+  REQUIRE(str(ch) == "1a");
+
+  map_t ch2{std::move(ch)};
+  REQUIRE(ch2.find(1)->second == "a");
+  REQUIRE(std::empty(ch));
+
+  map_t::bucket other[2];
+  map_t ch3{other};
+  map_t::segment d{2, "d"};
+  ch3.insert(d);
+  ch2.swap(ch3);
+  REQUIRE(str(ch2) == "2d");
+  REQUIRE(str(ch3) == "1a");
+
+  ch3 = std::move(ch2);
+  REQUIRE(!a.is_linked());
+  REQUIRE(str(ch3) == "2d");
+  REQUIRE(std::empty(ch2));
+}
+
+TEST_CASE("hash chain equal keys across a rehash") {
+  using chain_t = hash_chain<int, int>;
+  chain_t::bucket small[2], large[16];
+  chain_t ch{small};
+  chain_t::segment a{1, 100}, b{1, 200}, c{5, 1}, d{3, 7}, e{5, 2}, f{1, 300};
+  ch.insert(a);
+  ch.insert(b);
+  ch.insert(c);
+  ch.insert(d);
+
+  // Newer segments inserted while the old buckets are still in use
+  ch.rehash(large);
+  ch.insert(e);
+  REQUIRE(ch.find(5)->second == 2);
+  ch.insert(f);
+  ch.finish_rehash();
+  REQUIRE(ch.find(1)->second == 300);
+  REQUIRE(ch.find(5)->second == 2);
+  REQUIRE(ch.count(1) == 3);
+
+  f.unlink();
+  REQUIRE(ch.find(1)->second == 200);
+  b.unlink();
+  REQUIRE(ch.find(1)->second == 100);
+  e.unlink();
+  REQUIRE(ch.find(5)->second == 1);
+
+  // A long run of equal keys, interleaved with other keys
+  std::vector<chain_t::segment> run;
+  run.reserve(100);
+  for (int i = 0; i < 50; i++) {
+    ch.insert(run.emplace_back(7, i));
+    ch.insert(run.emplace_back(15 + 16 * i, i));
+  }
+  chain_t::bucket larger[64];
+  ch.rehash(larger);
+  ch.finish_rehash();
+  for (int i = 49; i >= 0; i--) {
+    auto it = ch.find(7);
+    REQUIRE(it->second == i);
+    ch.erase(it);
+  }
+  REQUIRE(!ch.contains(7));
+}
+
+TEST_CASE("hash chain incremental rehash") {
+  using chain_t = hash_chain<int, int>;
+  constexpr size_t n = 300;
+  chain_t::bucket small[4], large[64], larger[256];
+  chain_t ch{small};
+  std::vector<chain_t::segment> segs;
+  segs.reserve(2 * n);
+  for (size_t i = 0; i < n; i++)
+    ch.insert(segs.emplace_back(static_cast<int>(i), static_cast<int>(i)));
+
+  auto check = [&](size_t count) {
+    REQUIRE(std::size(ch) == count);
+    for (size_t i = 0; i < count; i++) {
+      auto it = ch.find(static_cast<int>(i));
+      REQUIRE(it != ch.end());
+      REQUIRE(it->second == static_cast<int>(i));
+    }
+    REQUIRE(!ch.contains(static_cast<int>(count)));
+  };
+
+  check(n);
+  ch.rehash(large);
+  REQUIRE(ch.rehashing());
+  REQUIRE(ch.bucket_count() == 64);
+  check(n);
+
+  // Each insert moves one bucket
+  ch.insert(segs.emplace_back(static_cast<int>(n), static_cast<int>(n)));
+  REQUIRE(ch.rehashing());
+  check(n + 1);
+  REQUIRE(ch.rehash_step(2));
+  check(n + 1);
+  ch.insert(segs.emplace_back(static_cast<int>(n + 1), static_cast<int>(n + 1)));
+  REQUIRE(!ch.rehashing());
+  check(n + 2);
+  REQUIRE(!ch.rehash_step());
+
+  // Unlinking during a rehash
+  ch.rehash(larger);
+  segs[0].unlink();
+  segs[n + 1].unlink();
+  REQUIRE(std::size(ch) == n);
+  REQUIRE(!ch.contains(0));
+  ch.finish_rehash();
+  REQUIRE(!ch.rehashing());
+  REQUIRE(std::size(ch) == n);
+  REQUIRE(ch.contains(1));
+  REQUIRE(!ch.contains(0));
+
+  // Clearing during a rehash
+  ch.rehash(small);
+  ch.rehash_step();
+  ch.clear();
+  REQUIRE(std::empty(ch));
+  REQUIRE(!segs[5].is_linked());
+  REQUIRE(!ch.rehashing());
+}
+
+}
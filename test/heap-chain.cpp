@@ -0,0 +1,159 @@
+#include <set>
+#include <string>
+#include <vector>
+#include <random>
+#include <utility>
+#include <optional>
+#include <functional>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/heap_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+template<typename Heap>
+std::string drain(Heap &h) {
+  std::string r;
+  while (!std::empty(h))
+    r += std::to_string(*h.pop());
+  return r;
+}
+
+TEST_CASE("heap chain push, top & pop") {
+  heap_chain<int> h;
+  REQUIRE(std::empty(h));
+  REQUIRE(std::size(h) == 0);
+  REQUIRE_THROWS(h.top());
+
+  decltype(h)::segment a{3}, b{1}, c{4}, d{1}, e{5};
+  for (auto *s : {&a, &b, &c, &d, &e})
+    h.push(*s);
+  REQUIRE(std::size(h) == 5);
+  REQUIRE(h.top() == 5);
+  REQUIRE(&h.top_segment() == &e);
+  REQUIRE_THROWS(h.push(a));
+
+  REQUIRE(&h.pop() == &e);
+  REQUIRE(!e.is_linked());
+  REQUIRE(h.top() == 4);
+
+  // Removing arbitrary segments
+  a.unlink();
+  REQUIRE(std::size(h) == 3);
+  REQUIRE_THROWS(a.unlink());
+  {
+    decltype(h)::segment f{2};
+    h.push(f);
+    REQUIRE(std::size(h) == 4);
+  }
+  REQUIRE(std::size(h) == 3);
+
+  // Changing priorities
+  *b = 7;
+  h.update(b);
+  REQUIRE(h.top() == 7);
+  REQUIRE(drain(h) == "741");
+  REQUIRE(!c.is_linked());
+
+  heap_chain<int, std::greater<>> minh;
+  decltype(minh)::segment x{3}, y{1}, z{2};
+  minh.push(x);
+  minh.push(y);
+  minh.push(z);
+  REQUIRE(drain(minh) == "123");
+}
+
+TEST_CASE("heap chain against std::multiset") {
+  using heap_t = heap_chain<int>;
+  constexpr size_t n = 500;
+  std::mt19937 rng{11};
+  std::vector<heap_t::segment> segs(n);
+  heap_t h;
+  std::multiset<int> model;
+
+  for (size_t round = 0; round < 5; round++) {
+    for (auto &s : segs) {
+      if (s.is_linked())
+        continue;
+      *s = static_cast<int>(rng() % 1000);
+      h.push(s);
+      model.insert(*s);
+    }
+    REQUIRE(std::size(h) == std::size(model));
+
+    for (size_t k = 0; k < n / 2; k++) {
+      auto &s = segs[rng() % n];
+      if (!s.is_linked())
+        continue;
+      switch (rng() % 3) {
+      case 0:
+        model.erase(model.find(*s));
+        s.unlink();
+        break;
+      case 1:
+        model.erase(model.find(*s));
+        *s = static_cast<int>(rng() % 1000);
+        model.insert(*s);
+        h.update(s);
+        break;
+      default:
+        model.erase(std::prev(model.end()));
+        h.pop();
+      }
+      REQUIRE(h.top() == *model.rbegin());
+    }
+    REQUIRE(std::size(h) == std::size(model));
+  }
+
+  while (!std::empty(model)) {
+    REQUIRE(*h.pop() == *model.rbegin());
+    model.erase(std::prev(model.end()));
+  }
+  REQUIRE(std::empty(h));
+}
+
+TEST_CASE("heap chain meld, move & clear") {
+  heap_chain<int> x, y;
+  std::vector<std::optional<decltype(x)::segment>> segs(6);
+  for (int i = 0; i < 6; i++) {
+    segs[i].emplace(i);
+    (i % 2 ? x : y).push(*segs[i]);
+  }
+  REQUIRE(x.top() == 5);
+  REQUIRE(y.top() == 4);
+
+  x.meld(y);
+  REQUIRE(std::empty(y));
+  REQUIRE(std::size(x) == 6);
+  REQUIRE_THROWS(x.meld(x));
+
+  // Moving segments inside the heap, including the root
+  decltype(x)::segment moved{std::move(*segs[5])};
+  REQUIRE(!segs[5]->is_linked());
+  REQUIRE(&x.top_segment() == &moved);
+  decltype(x)::segment moved2{std::move(*segs[0])};
+  segs[0].reset();
+  REQUIRE(std::size(x) == 6);
+
+  heap_chain<int> z{std::move(x)};
+  REQUIRE(std::empty(x));
+  REQUIRE(std::size(z) == 6);
+  x.swap(z);
+  REQUIRE(std::size(x) == 6);
+  REQUIRE(std::empty(z));
+
+  segs[3].reset();
+  REQUIRE(drain(x) == "54210");
+
+  for (auto &s : segs)
+    if (s)
+      x.push(*s);
+  x.push(moved);
+  REQUIRE(std::size(x) == 5);
+  x.clear();
+  REQUIRE(std::empty(x));
+  REQUIRE(!moved.is_linked());
+  REQUIRE(!segs[1]->is_linked());
+}
+
+}
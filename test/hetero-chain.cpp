@@ -0,0 +1,104 @@
+#include <string>
+#include <utility>
+#include <type_traits>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/hetero_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+struct circle { int r{0}; };
+struct square { int a{0}; };
+struct label {
+  std::string text;
+  label() = default;
+  label(const char *t) : text{t} {}
+};
+
+using shapes_t = hetero_chain<circle, square, label>;
+
+std::string describe(const shapes_t &ch) {
+  std::string r;
+  ch.visit([&](const auto &v) {
+    using T = std::decay_t<decltype(v)>;
+    if constexpr (std::is_same_v<T, circle>)
+      r += "c" + std::to_string(v.r);
+    else if constexpr (std::is_same_v<T, square>)
+      r += "s" + std::to_string(v.a);
+    else
+      r += "l" + v.text;
+  });
+  return r;
+}
+
+TEST_CASE("hetero chain type indices") {
+  static_assert(shapes_t::index_of<circle> == 0);
+  static_assert(shapes_t::index_of<square> == 1);
+  static_assert(shapes_t::index_of<label> == 2);
+  static_assert(std::is_same_v<shapes_t::index_type, std::uint8_t>);
+  static_assert(sizeof(shapes_t::segment<circle>)
+      <= sizeof(chain<std::uint8_t>::segment) + sizeof(int));
+}
+
+TEST_CASE("hetero chain link & visit") {
+  shapes_t ch;
+  REQUIRE(std::empty(ch));
+  REQUIRE(describe(ch) == "");
+
+  shapes_t::segment<circle> c{circle{1}};
+  shapes_t::segment<square> s{std::in_place, 2};
+  shapes_t::segment<label> l{label{"x"}};
+  shapes_t::segment<circle> c2;
+  c2->r = 3;
+
+  ch.link_back(s);
+  ch.link_back(l);
+  ch.link_front(c);
+  ch.link_back(c2);
+  REQUIRE(std::size(ch) == 4);
+  REQUIRE(describe(ch) == "c1s2lxc3");
+
+  ch.visit([](auto &v) {
+    using T = std::decay_t<decltype(v)>;
+    if constexpr (std::is_same_v<T, label>)
+      v.text += "y";
+  });
+  REQUIRE(l->text == "xy");
+
+  int sum = 0;
+  ch.for_each<circle>([&](circle &v) { sum += v.r; });
+  REQUIRE(sum == 4);
+
+  l.unlink();
+  REQUIRE(!l.is_linked());
+  REQUIRE(describe(ch) == "c1s2c3");
+  REQUIRE_THROWS(l.unlink());
+
+  ch.clear();
+  REQUIRE(std::empty(ch));
+  REQUIRE(!c.is_linked());
+}
+
+TEST_CASE("hetero chain segment move & scope") {
+  shapes_t ch;
+  shapes_t::segment<circle> a{circle{1}};
+  ch.link_back(a);
+  {
+    shapes_t::segment<label> b{label{"b"}};
+    ch.link_back(b);
+    shapes_t::segment<square> c{square{5}};
+    ch.link_back(c);
+    REQUIRE(describe(ch) == "c1lbs5");
+
+    shapes_t::segment<label> b2{std::move(b)};
+    REQUIRE(!b.is_linked());
+    REQUIRE(describe(ch) == "c1lbs5");
+  }
+  REQUIRE(describe(ch) == "c1");
+
+  shapes_t ch2{std::move(ch)};
+  REQUIRE(std::empty(ch));
+  REQUIRE(describe(ch2) == "c1");
+}
+
+}
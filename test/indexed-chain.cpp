@@ -0,0 +1,160 @@
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/indexed_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+template<typename Chain>
+std::string str(const Chain &ch) {
+  std::string r;
+  for (auto v : ch)
+    r += std::to_string(v);
+  return r;
+}
+
+TEST_CASE("indexed chain link & access") {
+  indexed_chain<int> ch;
+  REQUIRE(std::empty(ch));
+  REQUIRE(ch.begin() == ch.end());
+
+  decltype(ch)::segment a{1}, b{2}, c{3}, d{4};
+  ch.link_back(b);
+  ch.link_front(a);
+  ch.link_back(d);
+  auto it = ch.link_at(2, c);
+  REQUIRE(*it == 3);
+  REQUIRE(str(ch) == "1234");
+  REQUIRE(std::size(ch) == 4);
+  REQUIRE(ch.front() == 1);
+  REQUIRE(ch.back() == 4);
+  REQUIRE_THROWS(ch.link_back(a));
+  decltype(ch)::segment e{5};
+  REQUIRE_THROWS(ch.link_at(5, e));
+
+  for (int i = 0; i < 4; i++)
+    REQUIRE(ch[i] == i + 1);
+  REQUIRE_THROWS(ch[4]);
+  REQUIRE(&*ch.nth(1) == &*b);
+  REQUIRE(ch.nth(4) == ch.end());
+
+  REQUIRE(ch.index_of(a) == 0);
+  REQUIRE(ch.index_of(c) == 2);
+  REQUIRE(ch.index_of(d) == 3);
+  REQUIRE_THROWS(ch.index_of(e));
+
+  indexed_chain<int> otr;
+  otr.link_back(e);
+  REQUIRE_THROWS(ch.index_of(e));
+
+  auto nx = ch.unlink(ch.nth(1));
+  REQUIRE(*nx == 3);
+  REQUIRE(!b.is_linked());
+  REQUIRE(str(ch) == "134");
+  REQUIRE(ch.index_of(d) == 2);
+  REQUIRE(ch[1] == 3);
+
+  c.unlink();
+  REQUIRE(str(ch) == "14");
+  REQUIRE_THROWS(c.unlink());
+
+  ch.clear();
+  REQUIRE(std::empty(ch));
+  REQUIRE(!a.is_linked());
+  ch.link_back(c);
+  REQUIRE(str(ch) == "3");
+}
+
+TEST_CASE("indexed chain against a vector") {
+  // Small MaxLevel so the upper levels get crowded
+  using chain_t = indexed_chain<int, 3>;
+  constexpr size_t n = 500;
+  std::vector<chain_t::segment> segs(n);
+  for (size_t i = 0; i < n; i++)
+    *segs[i] = static_cast<int>(i);
+
+  chain_t ch;
+  std::vector<int> model;
+  std::mt19937 rng{7};
+
+  auto check = [&]() {
+    REQUIRE(std::size(ch) == std::size(model));
+    REQUIRE(std::equal(ch.begin(), ch.end(), model.begin(), model.end()));
+    for (size_t i = 0; i < std::size(model); i++) {
+      REQUIRE(ch[i] == model[i]);
+      REQUIRE(ch.index_of(segs[model[i]]) == i);
+    }
+  };
+
+  for (size_t round = 0; round < 4; round++) {
+    for (auto &s : segs) {
+      if (s.is_linked())
+        continue;
+      size_t idx = rng() % (std::size(model) + 1);
+      ch.link_at(idx, s);
+      model.insert(model.begin() + idx, *s);
+    }
+    check();
+
+    for (size_t k = 0; k < n / 2; k++) {
+      size_t idx = rng() % std::size(model);
+      if (k % 2)
+        segs[model[idx]].unlink();
+      else
+        ch.unlink(ch.nth(idx));
+      model.erase(model.begin() + idx);
+    }
+    check();
+  }
+}
+
+TEST_CASE("indexed chain segment & chain move") {
+  indexed_chain<std::string> x;
+  decltype(x)::segment a{"a"}, b{"b"}, c{"c"};
+  x.link_back(a);
+  x.link_back(b);
+  x.link_back(c);
+
+  {
+    decltype(x)::segment b2{std::move(b)};
+    REQUIRE(!b.is_linked());
+    REQUIRE(x.index_of(b2) == 1);
+    REQUIRE(&*x.nth(1) == &*b2);
+    REQUIRE(x[1] == "b");
+
+    b = std::move(b2);
+    REQUIRE(!b2.is_linked());
+    REQUIRE(x.index_of(b) == 1);
+  }
+  REQUIRE(std::size(x) == 3);
+
+  decltype(x) y{std::move(x)};
+  REQUIRE(std::empty(x));
+  REQUIRE(std::size(y) == 3);
+  REQUIRE(y.index_of(c) == 2);
+  REQUIRE(y[2] == "c");
+  REQUIRE(&*std::prev(y.end()) == &*c);
+
+  decltype(x)::segment d{"d"};
+  x.link_back(d);
+  x.swap(y);
+  REQUIRE(std::size(x) == 3);
+  REQUIRE(y[0] == "d");
+  b.unlink();
+  REQUIRE(x[1] == "c");
+  REQUIRE(x.index_of(c) == 1);
+  {
+    decltype(x)::segment e{"e"};
+    x.link_at(1, e);
+    REQUIRE(x.index_of(c) == 2);
+  }
+  REQUIRE(std::size(x) == 2);
+  REQUIRE(x.index_of(c) == 1);
+}
+
+}
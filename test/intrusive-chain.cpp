@@ -0,0 +1,246 @@
+#include <string>
+#include <utility>
+#include <iterator>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/intrusive_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+struct lru_tag;
+struct shard_tag;
+
+struct connection {
+  int fd{0};
+  chain_hook<lru_tag> lru;
+  chain_hook<shard_tag> shard;
+
+  connection() = default;
+  connection(int f) : fd{f} {}
+};
+
+using lru_chain = intrusive_chain<connection, member_hook<&connection::lru>>;
+using shard_chain = intrusive_chain<connection, member_hook<&connection::shard>>;
+
+template<typename Chain>
+std::string fds(const Chain &ch) {
+  std::string r;
+  for (const auto &c : ch)
+    r += std::to_string(c.fd);
+  return r;
+}
+
+TEST_CASE("intrusive chain link & unlink") {
+  lru_chain ch;
+  REQUIRE(std::empty(ch));
+  REQUIRE(std::size(ch) == 0);
+
+  connection a{1}, b{2}, c{3};
+  auto ib = ch.link_back(b);
+  ch.link_front(a);
+  ch.link_back(c);
+  REQUIRE(fds(ch) == "123");
+  REQUIRE(std::size(ch) == 3);
+  REQUIRE(&*ib == &b);
+  REQUIRE(&ch.front() == &a);
+  REQUIRE(&ch.back() == &c);
+  REQUIRE(ch.contains(b));
+  REQUIRE(a.lru.is_linked());
+  REQUIRE(!a.shard.is_linked());
+  REQUIRE_THROWS(ch.link_back(a));
+
+  auto it = ch.unlink(ib);
+  REQUIRE(&*it == &c);
+  REQUIRE(fds(ch) == "13");
+  REQUIRE(!ch.contains(b));
+  REQUIRE(!b.lru.is_linked());
+
+  ch.link(ch.iterator_to(c), b);
+  REQUIRE(fds(ch) == "123");
+  c.lru.unlink();
+  REQUIRE(fds(ch) == "12");
+  REQUIRE_THROWS(c.lru.unlink());
+
+  ch.clear();
+  REQUIRE(std::empty(ch));
+  REQUIRE(!a.lru.is_linked());
+}
+
+TEST_CASE("intrusive chain objects in multiple chains") {
+  lru_chain lru;
+  shard_chain shards[2];
+  {
+    connection a{1}, b{2}, c{3};
+    for (auto *con : {&a, &b, &c}) {
+      lru.link_front(*con);
+      shards[con->fd % 2].link_back(*con);
+    }
+    REQUIRE(fds(lru) == "321");
+    REQUIRE(fds(shards[0]) == "2");
+    REQUIRE(fds(shards[1]) == "13");
+
+    // Move to the front of the lru list
+    lru.unlink(lru.iterator_to(a));
+    lru.link_front(a);
+    REQUIRE(fds(lru) == "132");
+    REQUIRE(fds(shards[1]) == "13");
+
+    shards[1].unlink(shards[1].iterator_to(c));
+    REQUIRE(fds(lru) == "132");
+    REQUIRE(fds(shards[1]) == "1");
+  }
+  // Unlinked from all chains when going out of scope
+  REQUIRE(std::empty(lru));
+  REQUIRE(std::empty(shards[0]));
+  REQUIRE(std::empty(shards[1]));
+}
+
+TEST_CASE("intrusive chain object move & copy") {
+  lru_chain lru;
+  shard_chain shard;
+  connection a{1}, b{2}, c{3};
+  lru.link_back(a);
+  lru.link_back(b);
+  lru.link_back(c);
+  shard.link_back(b);
+
+  connection b2{std::move(b)};
+  REQUIRE(!b.lru.is_linked());
+  REQUIRE(!b.shard.is_linked());
+  REQUIRE(&*std::next(lru.begin()) == &b2);
+  REQUIRE(&shard.front() == &b2);
+  REQUIRE(fds(lru) == "123");
+
+  b = std::move(c);
+  REQUIRE(!c.lru.is_linked());
+  REQUIRE(&lru.back() == &b);
+  REQUIRE(fds(lru) == "123");
+
+  // Copies start out unlinked; assignment keeps the links
+  connection d{b2};
+  REQUIRE(d.fd == 2);
+  REQUIRE(!d.lru.is_linked());
+  REQUIRE(std::size(lru) == 3);
+  a = d;
+  REQUIRE(fds(lru) == "223");
+  REQUIRE(&lru.front() == &a);
+}
+
+TEST_CASE("intrusive chain move & swap") {
+  lru_chain x, y;
+  connection a{1}, b{2}, c{3};
+  x.link_back(a);
+  x.link_back(b);
+  y.link_back(c);
+
+  x.swap(y);
+  REQUIRE(fds(x) == "3");
+  REQUIRE(fds(y) == "12");
+
+  lru_chain z{std::move(y)};
+  REQUIRE(std::empty(y));
+  REQUIRE(fds(z) == "12");
+  REQUIRE(&*std::prev(z.end()) == &b);
+
+  x = std::move(z);
+  REQUIRE(!c.lru.is_linked());
+  REQUIRE(fds(x) == "12");
+}
+
+TEST_CASE("intrusive chain iterators") {
+  lru_chain ch;
+  connection a{1}, b{2};
+  ch.link_back(a);
+  ch.link_back(b);
+
+  static_assert(sizeof(lru_chain::iterator) == sizeof(void*));
+  const auto &cch = ch;
+  lru_chain::const_iterator it{ch.begin()};
+  REQUIRE(it == cch.begin());
+  REQUIRE(it->fd == 1);
+  REQUIRE((++it)->fd == 2);
+  REQUIRE(++it == cch.end());
+  REQUIRE((--it)->fd == 2);
+  REQUIRE(it-- != ch.begin());
+  REQUIRE(it == ch.begin());
+  REQUIRE(&*cch.iterator_to(b) == &b);
+}
+
+struct handler : chain_hook<> {
+  function_ptr<void, handler&, int> call;
+};
+
+template<typename Fn>
+struct lambda_handler : handler {
+  Fn fn;
+  lambda_handler(Fn f) : handler{{}, &invoke}, fn{std::move(f)} {}
+  static void invoke(handler &h, int v) {
+    static_cast<lambda_handler&>(h).fn(v);
+  }
+};
+
+TEST_CASE("intrusive chain with base hook & type erasure") {
+  intrusive_chain<handler> handlers;
+  static_assert(std::is_same_v<decltype(handlers), intrusive_chain<handler, base_hook<>>>);
+
+  int sum = 0;
+  std::string log;
+  lambda_handler a{[&sum](int v) { sum += v; }};
+  lambda_handler b{[&log](int v) { log += std::to_string(v); }};
+  handlers.link_back(a);
+  handlers.link_back(b);
+  REQUIRE(&handlers.front() == static_cast<handler*>(&a));
+
+  for (handler &h : handlers)
+    h.call(h, 4);
+  REQUIRE(sum == 4);
+  REQUIRE(log == "4");
+
+  {
+    auto c = std::move(b);
+    REQUIRE(!b.is_linked());
+    for (handler &h : handlers)
+      h.call(h, 2);
+    REQUIRE(sum == 6);
+    REQUIRE(log == "42");
+  }
+  REQUIRE(std::size(handlers) == 1);
+}
+
+struct a_tag;
+struct b_tag;
+struct twice : chain_hook<a_tag>, chain_hook<b_tag> {
+  int v{0};
+  chain_hook<> member;
+  twice(int x) : v{x} {}
+};
+
+TEST_CASE("intrusive chain with multiple base hooks & members") {
+  intrusive_chain<twice, base_hook<a_tag>> as;
+  intrusive_chain<twice, base_hook<b_tag>> bs;
+  intrusive_chain<twice, member_hook<&twice::member>> ms;
+  twice x{1}, y{2};
+  as.link_back(x);
+  as.link_back(y);
+  bs.link_back(y);
+  bs.link_back(x);
+  ms.link_front(x);
+
+  std::string r;
+  for (auto &t : as)
+    r += std::to_string(t.v);
+  for (auto &t : bs)
+    r += std::to_string(t.v);
+  for (auto &t : ms)
+    r += std::to_string(t.v);
+  REQUIRE(r == "12211");
+
+  static_cast<chain_hook<b_tag>&>(y).unlink();
+  REQUIRE(&bs.front() == &x);
+  REQUIRE(std::size(as) == 2);
+  ms.clear();
+  REQUIRE(!x.member.is_linked());
+  REQUIRE(static_cast<chain_hook<a_tag>&>(x).is_linked());
+}
+
+}
@@ -0,0 +1,132 @@
+#include <string>
+#include <utility>
+#include <optional>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/lru_cache.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+using cache_t = lru_cache<int, std::string, 8>;
+
+std::string keys(const cache_t &c) {
+  std::string r;
+  for (const auto &e : c)
+    r += std::to_string(e.key());
+  return r;
+}
+
+TEST_CASE("lru cache get, insert & evict") {
+  cache_t cache{3};
+  REQUIRE(std::empty(cache));
+  REQUIRE(cache.capacity() == 3);
+  REQUIRE(cache.lru() == nullptr);
+  REQUIRE(cache.evict_lru() == nullptr);
+  REQUIRE_THROWS(cache_t{0});
+
+  std::string evicted;
+  auto listener = on(cache.on_evict, [&](const int &k, std::string &v) {
+    evicted += std::to_string(k) + v;
+  });
+
+  cache_t::entry a{1, "a"}, b{2, "b"}, c{3, "c"}, d{4, "d"};
+  cache.insert(a);
+  cache.insert(b);
+  cache.insert(c);
+  REQUIRE(std::size(cache) == 3);
+  REQUIRE(keys(cache) == "321");
+  REQUIRE(a.is_cached());
+  REQUIRE_THROWS(cache.insert(a));
+
+  REQUIRE(*cache.get(1) == "a");
+  REQUIRE(keys(cache) == "132");
+  REQUIRE(cache.get(7) == nullptr);
+  REQUIRE(cache.hits() == 1);
+  REQUIRE(cache.misses() == 1);
+
+  // peek() neither touches nor counts
+  REQUIRE(cache.peek(2) == &b);
+  REQUIRE(cache.peek(7) == nullptr);
+  REQUIRE(keys(cache) == "132");
+  REQUIRE(cache.hits() == 1);
+
+  cache.insert(d);
+  REQUIRE(evicted == "2b");
+  REQUIRE(!b.is_cached());
+  REQUIRE(keys(cache) == "413");
+  REQUIRE(cache.get(2) == nullptr);
+  REQUIRE(cache.misses() == 2);
+
+  cache.touch(c);
+  REQUIRE(keys(cache) == "341");
+  REQUIRE(cache.lru() == &a);
+  REQUIRE_THROWS(cache.touch(b));
+
+  REQUIRE(cache.evict_lru() == &a);
+  REQUIRE(evicted == "2b1a");
+  REQUIRE(std::size(cache) == 2);
+
+  cache.erase(c);
+  REQUIRE(evicted == "2b1a");
+  REQUIRE(keys(cache) == "4");
+
+  cache.reset_stats();
+  REQUIRE(cache.hits() == 0);
+  REQUIRE(cache.misses() == 0);
+
+  cache.clear();
+  REQUIRE(std::empty(cache));
+  REQUIRE(!d.is_cached());
+  REQUIRE(evicted == "2b1a");
+}
+
+TEST_CASE("lru cache replacing keys & entry lifetime") {
+  cache_t cache;
+  std::string evicted;
+  auto listener = on(cache.on_evict, [&](const int &k, std::string &v) {
+    std::string reclaimed{std::move(v)};
+    evicted += std::to_string(k) + reclaimed;
+  });
+
+  cache_t::entry a{1, "a"}, a2{1, "x"};
+  cache.insert(a);
+  cache.insert(a2);
+  REQUIRE(evicted == "1a");
+  REQUIRE(a.value().empty()); // Moved out by the listener
+  REQUIRE(*cache.get(1) == "x");
+  REQUIRE(std::size(cache) == 1);
+
+  {
+    cache_t::entry b{2, "b"};
+    cache.insert(b);
+    REQUIRE(std::size(cache) == 2);
+  }
+  REQUIRE(std::size(cache) == 1);
+  REQUIRE(cache.get(2) == nullptr);
+
+  // Moving a cached entry keeps it in the cache
+  std::optional<cache_t::entry> moved{std::move(a2)};
+  REQUIRE(!a2.is_cached());
+  REQUIRE(moved->is_cached());
+  REQUIRE(cache.peek(1) == &*moved);
+  REQUIRE(keys(cache) == "1");
+
+  // Storage can be reused after eviction
+  cache.evict_lru();
+  moved.reset();
+  moved.emplace(5, "e");
+  cache.insert(*moved);
+  REQUIRE(*cache.get(5) == "e");
+  REQUIRE(evicted == "1a1x");
+
+  // Entries outliving the cache
+  cache_t::entry c{3, "c"};
+  {
+    cache_t tmp;
+    tmp.insert(c);
+    REQUIRE(c.is_cached());
+  }
+  REQUIRE(!c.is_cached());
+}
+
+}
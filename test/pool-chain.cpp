@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <type_traits>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/pool_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+using pch_t = pool_chain<int, 8>;
+using pch_segment = typename pch_t::segment;
+
+template<typename Chain>
+int digits(const Chain &ch) {
+  int r = 0;
+  for (auto v : ch)
+    r = r * 10 + v;
+  return r;
+}
+
+TEST_CASE("pool chain index type & segment size") {
+  static_assert(std::is_same_v<typename pool_chain<int, 250>::index_type, std::uint8_t>);
+  static_assert(std::is_same_v<typename pool_chain<int, 1000>::index_type, std::uint16_t>);
+  static_assert(std::is_same_v<typename pool_chain<int, 65534>::index_type, std::uint16_t>);
+  static_assert(std::is_same_v<typename pool_chain<int, 65535>::index_type, std::uint32_t>);
+  static_assert(sizeof(pool_chain<int, 1000>::segment) == 8);
+  static_assert(sizeof(pool_chain<std::uint16_t, 1000>::segment) == 6);
+}
+
+TEST_CASE("pool chain link & unlink") {
+  pch_t::pool_type pool;
+  pch_t ch{pool};
+  REQUIRE(std::empty(ch));
+  REQUIRE(std::size(ch) == 0);
+
+  for (int i = 0; i < 8; i++)
+    *pool[i] = i;
+
+  auto i3 = ch.link_back(pool[3]);
+  ch.link_back(pool[5]);
+  ch.link_front(pool[1]);
+  ch.link(i3, pool[7]);
+  REQUIRE(digits(ch) == 1735);
+  REQUIRE(std::size(ch) == 4);
+  REQUIRE(ch.front() == 1);
+  REQUIRE(ch.back() == 5);
+  REQUIRE(ch[1] == 7);
+  REQUIRE(&ch.segments()[2] == &pool[3]);
+  REQUIRE(i3.index() == 3);
+  REQUIRE(ch.index_of(pool[7]) == 7);
+
+  REQUIRE_THROWS(ch.link_back(pool[3]));
+  pch_segment outside;
+  REQUIRE_THROWS(ch.link_back(outside));
+
+  auto it = ch.unlink(i3);
+  REQUIRE(*it == 5);
+  REQUIRE(!pool[3].is_linked());
+  REQUIRE(digits(ch) == 175);
+
+  ch.unlink(pool[1]);
+  REQUIRE(digits(ch) == 75);
+  REQUIRE_THROWS(ch.unlink(pool[1]));
+
+  ch.clear();
+  REQUIRE(std::empty(ch));
+  REQUIRE(!pool[5].is_linked());
+}
+
+TEST_CASE("pool chains sharing a pool") {
+  pch_segment pool[8];
+  {
+    pch_t a{pool}, b{pool};
+    a.place_back(pool[0], 1);
+    b.place_back(pool[1], 2);
+    a.place_front(pool[2], 3);
+    b.place_back(pool[3], 4);
+    REQUIRE(digits(a) == 31);
+    REQUIRE(digits(b) == 24);
+
+    b.unlink(pool[1]);
+    a.link_back(pool[1]);
+    REQUIRE(digits(a) == 312);
+    REQUIRE(digits(b) == 4);
+
+    // Moving chains is O(1), since segments refer to the header by index
+    pch_t c{std::move(a)};
+    REQUIRE(std::empty(a));
+    REQUIRE(digits(c) == 312);
+    std::swap(b, c);
+    REQUIRE(digits(b) == 312);
+    REQUIRE(digits(c) == 4);
+  }
+  // Destroying the chains unlinks the segments
+  for (auto &seg : pool)
+    REQUIRE(!seg.is_linked());
+}
+
+TEST_CASE("pool chain iterators") {
+  pch_t::pool_type pool;
+  pch_t ch{pool};
+  ch.place_back(pool[4], 1);
+  ch.place_back(pool[2], 2);
+
+  auto it = ch.begin();
+  REQUIRE(&*it++ == &pool[4].value());
+  REQUIRE(&it.segment() == &pool[2]);
+  REQUIRE(++it == ch.end());
+  REQUIRE_THROWS(*it);
+  REQUIRE_THROWS(++it);
+  REQUIRE(&*--it == &pool[2].value());
+  --it;
+  REQUIRE_THROWS(--it);
+
+  const pch_t &cch = ch;
+  typename pch_t::const_iterator cit{ch.begin()};
+  REQUIRE(cit == cch.begin());
+  REQUIRE(std::size(cch.segments()) == 2);
+}
+
+}
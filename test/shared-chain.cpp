@@ -0,0 +1,112 @@
+#include <new>
+#include <string>
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/compact_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+using sch_t = shared_chain<int>;
+using sch_segment = typename sch_t::segment;
+
+struct region_layout {
+  sch_t ch;
+  sch_segment segs[16];
+};
+
+// Shared memory object that is mapped twice, at different addresses
+struct shm_region {
+  int fd{-1};
+  void *a{nullptr}, *b{nullptr};
+
+  shm_region() {
+    std::string name = "/heapfree-test-" + std::to_string(getpid());
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    REQUIRE(fd >= 0);
+    shm_unlink(name.c_str());
+    REQUIRE(ftruncate(fd, sizeof(region_layout)) == 0);
+    a = map();
+    b = map();
+  }
+
+  ~shm_region() {
+    munmap(a, sizeof(region_layout));
+    munmap(b, sizeof(region_layout));
+    close(fd);
+  }
+
+  void* map() {
+    void *r = mmap(nullptr, sizeof(region_layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    REQUIRE(r != MAP_FAILED);
+    return r;
+  }
+};
+
+int digits(const sch_t &ch) {
+  int r = 0;
+  for (auto v : ch)
+    r = r * 10 + v;
+  return r;
+}
+
+TEST_CASE("shared chain is valid in a second mapping") {
+  shm_region shm;
+  REQUIRE(shm.a != shm.b);
+
+  auto *ra = new (shm.a) region_layout{};
+  for (int i = 1; i <= 3; i++) {
+    *ra->segs[i] = i;
+    ra->ch.link_back(ra->segs[i]);
+  }
+
+  auto *rb = static_cast<region_layout*>(shm.b);
+  REQUIRE(digits(rb->ch) == 123);
+  REQUIRE(&rb->ch.segments()[1] == &rb->segs[2]);
+
+  // Modifications through either mapping are visible in the other one
+  rb->segs[2].unlink();
+  *rb->segs[5] = 5;
+  rb->ch.link_front(rb->segs[5]);
+  REQUIRE(digits(ra->ch) == 513);
+
+  ra->~region_layout();
+  REQUIRE(std::empty(rb->ch));
+}
+
+TEST_CASE("shared chain between two processes") {
+  shm_region shm;
+  auto *ra = new (shm.a) region_layout{};
+  *ra->segs[0] = 1;
+  ra->ch.link_back(ra->segs[0]);
+
+  pid_t pid = fork();
+  REQUIRE(pid >= 0);
+  if (pid == 0) {
+    // Producer: Use a fresh mapping at yet another address
+    auto *rc = static_cast<region_layout*>(shm.map());
+    bool ok = digits(rc->ch) == 1;
+    for (int i = 2; i <= 4; i++) {
+      *rc->segs[i] = i;
+      rc->ch.link_back(rc->segs[i]);
+    }
+    _exit(ok ? 0 : 1);
+  }
+
+  int status = 0;
+  REQUIRE(waitpid(pid, &status, 0) == pid);
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == 0);
+
+  // Consumer: iterate over the segments linked by the other process
+  auto *rb = static_cast<region_layout*>(shm.b);
+  REQUIRE(digits(rb->ch) == 1234);
+  REQUIRE(digits(ra->ch) == 1234);
+  ra->~region_layout();
+}
+
+}
@@ -0,0 +1,157 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <random>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/skip_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+template<typename Chain>
+std::string str(const Chain &ch) {
+  std::string r;
+  for (const auto &[k, v] : ch)
+    r += std::to_string(k) + v;
+  return r;
+}
+
+TEST_CASE("skip chain insert & lookup") {
+  skip_chain<int, std::string> ch;
+  REQUIRE(std::empty(ch));
+  REQUIRE(ch.begin() == ch.end());
+
+  decltype(ch)::segment a{30, "c"}, b{10, "a"}, c{20, "b"}, d{20, "x"};
+  auto ia = ch.insert(a);
+  REQUIRE(&*ia == &*a);
+  ch.insert(b);
+  ch.insert(c);
+  ch.insert(d);
+  REQUIRE(str(ch) == "10a20b20x30c");
+  REQUIRE(std::size(ch) == 4);
+  REQUIRE(ch.front().second == "a");
+  REQUIRE(ch.back().first == 30);
+  REQUIRE_THROWS(ch.insert(a));
+
+  REQUIRE(ch.lower_bound(15)->second == "b");
+  REQUIRE(ch.lower_bound(20)->second == "b");
+  REQUIRE(ch.upper_bound(20)->second == "c");
+  REQUIRE(ch.lower_bound(31) == ch.end());
+  REQUIRE(ch.lower_bound(0) == ch.begin());
+  REQUIRE(ch.find(15) == ch.end());
+  REQUIRE(&ch.find(20).segment() == &c);
+  REQUIRE(ch.contains(30));
+  REQUIRE(!ch.contains(40));
+  REQUIRE(std::size(ch.equal_range(20)) == 2);
+  REQUIRE(std::empty(ch.equal_range(25)));
+
+  const auto &cch = ch;
+  REQUIRE(cch.find(10)->second == "a");
+  REQUIRE(cch.lower_bound(11)->first == 20);
+
+  auto it = ch.erase(ch.find(10));
+  REQUIRE(&*it == &*c);
+  REQUIRE(!b.is_linked());
+  REQUIRE(str(ch) == "20b20x30c");
+
+  REQUIRE(ch.erase(20) == 2);
+  REQUIRE(ch.erase(20) == 0);
+  REQUIRE(str(ch) == "30c");
+
+  a.unlink();
+  REQUIRE(std::empty(ch));
+  REQUIRE_THROWS(a.unlink());
+
+  {
+    decltype(ch)::segment e{5, "e"};
+    ch.insert(e);
+    ch.insert(b);
+    REQUIRE(str(ch) == "5e10a");
+  }
+  REQUIRE(str(ch) == "10a");
+  ch.clear();
+  REQUIRE(!b.is_linked());
+}
+
+TEST_CASE("skip chain against std::multimap") {
+  using chain_t = skip_chain<int, int, 3>;
+  constexpr size_t n = 600;
+  std::mt19937 rng{3};
+  std::vector<chain_t::segment> segs;
+  segs.reserve(n);
+  for (size_t i = 0; i < n; i++)
+    segs.emplace_back(static_cast<int>(rng() % 200), static_cast<int>(i));
+
+  chain_t ch;
+  std::multimap<int, int> model;
+  auto check = [&]() {
+    REQUIRE(std::equal(ch.begin(), ch.end(), model.begin(), model.end()));
+    for (int k = -1; k <= 200; k++) {
+      auto it = ch.lower_bound(k);
+      auto mit = model.lower_bound(k);
+      REQUIRE((it == ch.end()) == (mit == model.end()));
+      if (mit != model.end())
+        REQUIRE(*it == *mit);
+      REQUIRE(std::size(ch.equal_range(k)) == model.count(k));
+    }
+  };
+
+  for (size_t round = 0; round < 3; round++) {
+    for (auto &s : segs) {
+      if (s.is_linked())
+        continue;
+      ch.insert(s);
+      model.emplace(s->first, s->second);
+    }
+    check();
+
+    for (size_t i = 0; i < n; i += 1 + rng() % 3) {
+      auto &s = segs[i];
+      if (!s.is_linked())
+        continue;
+      auto range = model.equal_range(s->first);
+      model.erase(std::find_if(range.first, range.second,
+          [&](auto &kv) { return kv.second == s->second; }));
+      s.unlink();
+    }
+    check();
+  }
+}
+
+TEST_CASE("skip chain move & custom compare") {
+  skip_chain<int, std::string, 4, std::greater<>> x;
+  decltype(x)::segment a{1, "a"}, b{2, "b"}, c{3, "c"};
+  x.insert(a);
+  x.insert(c);
+  x.insert(b);
+  REQUIRE(str(x) == "3c2b1a");
+  REQUIRE(x.lower_bound(2)->second == "b");
+
+  {
+    decltype(x)::segment b2{std::move(b)};
+    REQUIRE(!b.is_linked());
+    REQUIRE(str(x) == "3c2b1a");
+    REQUIRE(&x.find(2).segment() == &b2);
+  }
+  REQUIRE(str(x) == "3c1a");
+
+  decltype(x) y{std::move(x)};
+  REQUIRE(std::empty(x));
+  REQUIRE(str(y) == "3c1a");
+  REQUIRE(y.find(1)->second == "a");
+  REQUIRE(&*std::prev(y.end()) == &*a);
+
+  decltype(x)::segment d{7, "d"};
+  x.insert(d);
+  x.swap(y);
+  REQUIRE(str(x) == "3c1a");
+  REQUIRE(str(y) == "7d");
+  x.insert(b);
+  REQUIRE(&x.find(2).segment() == &b);
+}
+
+}
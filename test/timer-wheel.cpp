@@ -0,0 +1,216 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <random>
+#include <utility>
+#include <optional>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/timer_wheel.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+using wheel_t = timer_wheel<3, 4>; // 64 ticks in range
+
+struct named_timer : wheel_t::timer {
+  char name;
+  std::string *log;
+  named_timer(char n, std::string &l) : timer{&fired}, name{n}, log{&l} {}
+  static void fired(wheel_t::timer &t) {
+    auto &self = static_cast<named_timer&>(t);
+    *self.log += self.name;
+  }
+};
+
+TEST_CASE("timer wheel arm, cancel & fire") {
+  std::string log;
+  wheel_t w;
+  REQUIRE(w.now() == 0);
+  REQUIRE(std::size(w) == 0);
+
+  named_timer a{'a', log}, b{'b', log}, c{'c', log}, d{'d', log};
+  w.arm(c, 30);
+  w.arm(a, 3);
+  w.arm(b, 17);
+  w.arm(d, 17);
+  REQUIRE(a.is_armed());
+  REQUIRE(a.deadline() == 3);
+  REQUIRE(std::size(w) == 4);
+
+  REQUIRE(w.advance(2) == 0);
+  REQUIRE(w.now() == 2);
+  REQUIRE(w.advance(3) == 1);
+  REQUIRE(log == "a");
+  REQUIRE(!a.is_armed());
+
+  // Cancelling explicitly & by destruction
+  d.cancel();
+  REQUIRE(!d.is_armed());
+  d.cancel();
+  {
+    named_timer e{'e', log};
+    w.arm(e, 20);
+    REQUIRE(std::size(w) == 3);
+  }
+  REQUIRE(std::size(w) == 2);
+
+  // Rearming moves the timer
+  w.arm(c, 10);
+  REQUIRE(w.advance(16) == 1);
+  REQUIRE(log == "ac");
+  REQUIRE(w.advance(100) == 1);
+  REQUIRE(log == "acb");
+  REQUIRE(w.now() == 100);
+  REQUIRE_THROWS(w.advance(99));
+
+  // Deadlines in the past fire on the next advance
+  w.arm(a, 50);
+  w.arm_in(b, 0);
+  REQUIRE(w.advance(100) == 2);
+  REQUIRE(log == "acbab");
+
+  // Moving armed timers
+  w.arm_in(a, 5);
+  named_timer moved{std::move(a)};
+  REQUIRE(!a.is_armed());
+  REQUIRE(moved.is_armed());
+  REQUIRE(w.advance(105) == 1);
+  REQUIRE(log == "acbaba");
+
+  w.arm_in(b, 1);
+  w.arm_in(c, 1000);
+  w.clear();
+  REQUIRE(!b.is_armed());
+  REQUIRE(!c.is_armed());
+  REQUIRE(w.advance(2000) == 0);
+}
+
+TEST_CASE("timer wheel rearming in callbacks") {
+  struct periodic : wheel_t::timer {
+    wheel_t *wheel;
+    std::vector<wheel_t::tick_type> fired_at;
+    periodic(wheel_t &w) : timer{&fire}, wheel{&w} {}
+    static void fire(wheel_t::timer &t) {
+      auto &self = static_cast<periodic&>(t);
+      self.fired_at.push_back(self.wheel->now());
+      if (std::size(self.fired_at) < 5)
+        self.wheel->arm_in(self, 7);
+    }
+  };
+
+  wheel_t w{1000};
+  periodic p{w};
+  w.arm_in(p, 7);
+  w.advance(1100);
+  REQUIRE(p.fired_at == std::vector<wheel_t::tick_type>{1007, 1014, 1021, 1028, 1035});
+  REQUIRE(!p.is_armed());
+
+  // Callbacks may arm timers that are already due; they fire on the
+  // next call to advance
+  p.fired_at.clear();
+  p.set_callback([](wheel_t::timer &t) {
+    auto &self = static_cast<periodic&>(t);
+    self.fired_at.push_back(self.wheel->now());
+    if (std::size(self.fired_at) < 3)
+      self.wheel->arm_in(self, 0);
+  });
+  w.arm_in(p, 1);
+  REQUIRE(w.advance(1101) == 1);
+  REQUIRE(p.is_armed());
+  REQUIRE(w.advance(1101) == 1);
+  REQUIRE(w.advance(1102) == 1);
+  REQUIRE(!p.is_armed());
+  REQUIRE(p.fired_at == std::vector<wheel_t::tick_type>{1101, 1101, 1101});
+
+  // With ticks left to go, they fire after the next tick of the same call
+  p.fired_at.clear();
+  w.arm_in(p, 1);
+  REQUIRE(w.advance(1110) == 3);
+  REQUIRE(!p.is_armed());
+  REQUIRE(p.fired_at == std::vector<wheel_t::tick_type>{1103, 1104, 1105});
+}
+
+TEST_CASE("timer wheel against std::multimap") {
+  // Deadlines well beyond the range of the wheel, random steps and
+  // random cancellations; every timer must fire exactly at its deadline
+  struct checked_timer : wheel_t::timer {
+    wheel_t *wheel;
+    size_t fired{0};
+    checked_timer() : timer{&fire} {}
+    static void fire(wheel_t::timer &t) {
+      auto &self = static_cast<checked_timer&>(t);
+      REQUIRE(self.deadline() == self.wheel->now());
+      self.fired++;
+    }
+  };
+
+  constexpr size_t n = 300;
+  std::mt19937 rng{5};
+  std::vector<checked_timer> timers(n);
+  std::multimap<wheel_t::tick_type, size_t> model;
+  wheel_t w{12345};
+
+  for (size_t round = 0; round < 40; round++) {
+    for (size_t k = 0; k < n / 4; k++) {
+      size_t i = rng() % n;
+      auto &t = timers[i];
+      t.wheel = &w;
+      if (t.is_armed()) {
+        auto range = model.equal_range(t.deadline());
+        for (auto it = range.first; it != range.second; ++it)
+          if (it->second == i) {
+            model.erase(it);
+            break;
+          }
+      }
+      if (rng() % 4 == 0) {
+        t.cancel();
+        continue;
+      }
+      // Mostly short timeouts, some far beyond the range of the wheel
+      wheel_t::tick_type delay = rng() % 8 == 0 ? rng() % 5000 : 1 + rng() % 70;
+      w.arm_in(t, delay);
+      model.emplace(t.deadline(), i);
+    }
+    REQUIRE(std::size(w) == std::size(model));
+
+    wheel_t::tick_type to = w.now() + rng() % 200;
+    size_t expected = std::distance(model.begin(), model.upper_bound(to));
+    std::vector<size_t> before;
+    for (auto &t : timers)
+      before.push_back(t.fired);
+    REQUIRE(w.advance(to) == expected);
+    for (auto it = model.begin(); it != model.upper_bound(to);) {
+      REQUIRE(timers[it->second].fired == before[it->second] + 1);
+      REQUIRE(!timers[it->second].is_armed());
+      it = model.erase(it);
+    }
+    REQUIRE(std::size(w) == std::size(model));
+  }
+
+  w.advance(w.now() + 10000);
+  REQUIRE(std::size(w) == 0);
+}
+
+TEST_CASE("timer wheel move") {
+  std::string log;
+  std::optional<named_timer> a, b;
+  a.emplace('a', log);
+  b.emplace('b', log);
+  wheel_t w{7};
+  w.arm_in(*a, 1);
+  w.arm_in(*b, 100);
+
+  wheel_t w2{std::move(w)};
+  REQUIRE(std::size(w) == 0);
+  REQUIRE(std::size(w2) == 2);
+  REQUIRE(w2.now() == 7);
+  REQUIRE(w2.advance(200) == 2);
+  REQUIRE(log == "ab");
+
+  w2.arm_in(*a, 1);
+  a.reset();
+  REQUIRE(std::size(w2) == 0);
+}
+
+}
@@ -0,0 +1,121 @@
+#include <iterator>
+#include <utility>
+#include <catch2/catch.hpp>
+#include "hardwave/heapfree/unrolled_chain.hpp"
+
+namespace {
+using namespace hardwave::heapfree;
+
+using uch_t = unrolled_chain<int, 3>;
+using uch_segment = typename uch_t::segment;
+
+template<typename Chain>
+long digits(const Chain &ch) {
+  long r = 0;
+  for (auto v : ch)
+    r = r * 10 + v;
+  return r;
+}
+
+TEST_CASE("unrolled chain segment values") {
+  uch_segment seg;
+  REQUIRE(seg->empty());
+  REQUIRE(seg->capacity() == 3);
+  seg->push_back(1);
+  seg->push_back(2);
+  REQUIRE(seg->size() == 2);
+  REQUIRE((*seg)[1] == 2);
+  REQUIRE_THROWS((*seg)[2]);
+  seg->push_back(3);
+  REQUIRE(seg->full());
+  REQUIRE_THROWS(seg->push_back(4));
+  seg->pop_back();
+  REQUIRE(seg->size() == 2);
+}
+
+TEST_CASE("unrolled chain push_back & iteration") {
+  uch_t ch;
+  REQUIRE(std::empty(ch));
+  REQUIRE(!ch.try_push_back(1));
+  REQUIRE_THROWS(ch.push_back(1));
+
+  uch_segment a, b, c;
+  uch_segment *spare[] = {&b, &c};
+  size_t used = 0;
+  ch.link_back(a);
+  for (int i = 1; i <= 7; i++) {
+    if (!ch.try_push_back(i)) {
+      ch.link_back(*spare[used++]);
+      ch.push_back(i);
+    }
+  }
+  REQUIRE(a->size() == 3);
+  REQUIRE(b->size() == 3);
+  REQUIRE(c->size() == 1);
+  REQUIRE(std::size(ch) == 7);
+  REQUIRE(digits(ch) == 1234567);
+  REQUIRE(ch.front() == 1);
+
+  long sum = 0;
+  ch.for_each([&](int v) { sum += v; });
+  REQUIRE(sum == 28);
+
+  // Empty segments are skipped
+  b->clear();
+  REQUIRE(digits(ch) == 1237);
+  a->clear();
+  REQUIRE(digits(ch) == 7);
+  c->clear();
+  REQUIRE(std::empty(ch));
+  REQUIRE(std::size(ch.segments()) == 3);
+}
+
+TEST_CASE("unrolled chain segments unlink & move") {
+  uch_t ch;
+  uch_segment a;
+  a->push_back(1);
+  ch.link_back(a);
+  {
+    uch_segment b;
+    b->push_back(2);
+    b->push_back(3);
+    ch.link_back(b);
+    REQUIRE(digits(ch) == 123);
+  }
+  REQUIRE(digits(ch) == 1);
+
+  uch_segment c{std::move(a)};
+  REQUIRE(!a.is_linked());
+  REQUIRE(digits(ch) == 1);
+  c->push_back(4);
+  REQUIRE(digits(ch) == 14);
+
+  uch_t ch2{std::move(ch)};
+  REQUIRE(std::empty(ch));
+  REQUIRE(digits(ch2) == 14);
+}
+
+TEST_CASE("unrolled chain iterators") {
+  uch_t ch;
+  uch_segment a, b;
+  a->push_back(1);
+  b->push_back(2);
+  b->push_back(3);
+  ch.link_back(a);
+  ch.link_back(b);
+
+  auto it = ch.begin();
+  REQUIRE(&*it++ == &(*a)[0]);
+  REQUIRE(&it.segment() == &b);
+  *it = 5;
+  REQUIRE((*b)[0] == 5);
+  REQUIRE(&*++it == &(*b)[1]);
+  REQUIRE(++it == ch.end());
+
+  const uch_t &cch = ch;
+  typename uch_t::const_iterator cit{ch.begin()};
+  REQUIRE(cit == cch.begin());
+  REQUIRE(digits(cch) == 153);
+}
+
+}